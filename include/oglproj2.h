@@ -23,6 +23,11 @@ class ArticulatedFigure {
 	glm::vec3 leftHipOffset = glm::vec3(-0.28f, -0.4f, 0.0f);
 	glm::vec3 rightHipOffset = glm::vec3(0.28f, -0.4f, 0.0f);
 
+	// collision proxy radii (capsules around each bone)
+	float torsoRadius = 0.35f;
+	float torsoHalfHeight = 0.4f;
+	float limbRadius = 0.14f;
+
 	// gait params
 	float stepFreq = 1.0f;                     // steps per second
 	float hipAmplitude = glm::radians(30.0f);  // hip swing amplitude
@@ -69,6 +74,16 @@ class ArticulatedFigure {
 		glm::mat4 rightShinWorld = rootMat * rightHipLocal * rightKneeLocal;
 		outTransforms[4] = rightShinWorld * glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -shinLength * 0.5f, 0.0f));
 	}
+
+	// capsule segments (world space) for the bones from evaluateBones(), same order; bones are centered at their midpoint
+	void boneCapsules(const glm::mat4 *bones, glm::vec3 *outA, glm::vec3 *outB, float *outRadius) const {
+		const float halfLen[5] = {torsoHalfHeight, thighLength * 0.5f, shinLength * 0.5f, thighLength * 0.5f, shinLength * 0.5f};
+		for (int i = 0; i < 5; i++) {
+			outA[i] = glm::vec3(bones[i] * glm::vec4(0.0f, halfLen[i], 0.0f, 1.0f));
+			outB[i] = glm::vec3(bones[i] * glm::vec4(0.0f, -halfLen[i], 0.0f, 1.0f));
+			outRadius[i] = (i == 0) ? torsoRadius : limbRadius;
+		}
+	}
 };
 } // namespace oglprojs
 #endif // OGLPROJ2_H
\ No newline at end of file
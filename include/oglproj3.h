@@ -5,6 +5,11 @@
 
 namespace oglprojs {
 struct RigidBody {
+	enum Shape {
+		SPHERE = 0,
+		CAPSULE = 1 // segment position +/- halfAxis, swept by radius
+	} shape = SPHERE;
+
 	glm::vec3 position = glm::vec3(0.0f);
 	glm::vec3 velocity = glm::vec3(0.0f);
 	glm::quat orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
@@ -16,12 +21,30 @@ struct RigidBody {
 	float restitution = 0.5f; // bounciness
 	float invInertia = 1.0f;  // inverse scalar inertia (approx for sphere)
 
+	// kinematic bodies are driven from outside (animation), never by gravity or impulses
+	bool kinematic = false;
+	glm::vec3 halfAxis = glm::vec3(0.0f); // capsule only: center -> end point
+
 	// convenience
 	glm::mat4 modelMatrix() const {
 		return glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(orientation) * glm::scale(glm::mat4(1.0f), glm::vec3(radius));
 	}
 
+	// closest point of the body's core (center for sphere, segment for capsule) to p
+	glm::vec3 closestPoint(const glm::vec3 &p) const {
+		if (shape == SPHERE) return position;
+		float len2 = glm::dot(halfAxis, halfAxis);
+		if (len2 <= 0.0f) return position;
+		float t = glm::clamp(glm::dot(p - position, halfAxis) / len2, -1.0f, 1.0f);
+		return position + halfAxis * t;
+	}
+
 	void finalizeParams() {
+		if (kinematic) {
+			invMass = 0.0f;
+			invInertia = 0.0f;
+			return;
+		}
 		invMass = (mass > 0.0f) ? 1.0f / mass : 0.0f;
 		// Solid sphere inertia: I = 2/5 m r^2 -> inv = 1 / I
 		float I = (2.0f / 5.0f) * mass * radius * radius;
@@ -31,9 +54,19 @@ struct RigidBody {
 
 class PhysicsEngine {
   public:
+	struct Contact {
+		glm::vec3 point;
+		glm::vec3 normal;
+		float penetration;
+	};
+
 	glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
 	std::vector<RigidBody> bodies;
 
+	// contacts of the last step (only filled when recordContacts is on, for debug drawing)
+	bool recordContacts = false;
+	std::vector<Contact> contacts;
+
 	// basic world plane (y = 0)
 	float groundY = 0.0f;
 	float defaultRestitution = 0.45f;
@@ -45,11 +78,41 @@ class PhysicsEngine {
 		bodies.back().finalizeParams();
 	}
 
+	// Kinematic capsule collider (e.g. a bone of an articulated figure), returns its index in bodies
+	size_t addKinematicCapsule(const glm::vec3 &a, const glm::vec3 &b, float radius, float restitution = 0.5f) {
+		RigidBody c;
+		c.shape = RigidBody::CAPSULE;
+		c.kinematic = true;
+		c.position = (a + b) * 0.5f;
+		c.halfAxis = (a - b) * 0.5f;
+		c.radius = radius;
+		c.restitution = restitution;
+		addBody(c);
+		return bodies.size() - 1;
+	}
+
+	// Move a kinematic capsule to a new segment; velocity is derived from the displacement so contacts push bodies along
+	void moveKinematicCapsule(size_t idx, const glm::vec3 &a, const glm::vec3 &b, float dt) {
+		RigidBody &c = bodies[idx];
+		glm::vec3 center = (a + b) * 0.5f;
+		c.velocity = (dt > 0.0f) ? (center - c.position) / dt : glm::vec3(0.0f);
+		c.position = center;
+		c.halfAxis = (a - b) * 0.5f;
+	}
+
+	// Remove bodies by index (e.g. kinematic proxies of a figure that got disabled)
+	void removeBodies(std::vector<size_t> indices) {
+		std::sort(indices.begin(), indices.end(), std::greater<size_t>());
+		for (size_t idx : indices)
+			if (idx < bodies.size()) bodies.erase(bodies.begin() + idx);
+	}
+
 	void step(float dt) {
 		if (dt <= 0.0f) return;
+		contacts.clear();
 		// Integrate forces (semi-implicit Euler)
 		for (auto &b : bodies) {
-			if (b.invMass == 0.0f) continue; // static
+			if (b.invMass == 0.0f) continue; // static or kinematic
 			// linear
 			b.velocity += gravity * dt;
 			// angular: no external torques
@@ -71,12 +134,33 @@ class PhysicsEngine {
 		}
 
 		// Ground collisions
-		for (auto &b : bodies) { resolveGround(b, dt); }
+		for (auto &b : bodies) {
+			if (!b.kinematic) resolveGround(b, dt);
+		}
+	}
+
+	// feed velocities, capsule cores and recorded contacts to a debug batcher
+	void debugDraw(DebugDraw &dd) const {
+		for (const auto &b : bodies) {
+			if (b.shape == RigidBody::CAPSULE) dd.line(b.position - b.halfAxis, b.position + b.halfAxis, glm::vec4(0.2f, 0.8f, 1.0f, 1.0f));
+			dd.arrow(b.position, b.velocity * 0.25f, glm::vec4(1.0f, 1.0f, 0.2f, 1.0f));
+		}
+		for (const auto &c : contacts) {
+			dd.point(c.point, glm::vec4(1.0f, 0.2f, 0.2f, 1.0f));
+			dd.arrow(c.point, c.normal * 0.3f, glm::vec4(1.0f, 0.2f, 0.2f, 1.0f));
+		}
 	}
 
   private:
 	void resolveSphereSphere(RigidBody &A, RigidBody &B, float dt) {
-		glm::vec3 n = B.position - A.position;
+		if (A.invMass + B.invMass == 0.0f) return; // static/kinematic pair
+
+		// a capsule behaves like a sphere centered at its closest core point
+		glm::vec3 ca = A.position, cb = B.position;
+		if (A.shape == RigidBody::CAPSULE) ca = A.closestPoint(cb);
+		else if (B.shape == RigidBody::CAPSULE) cb = B.closestPoint(ca);
+
+		glm::vec3 n = cb - ca;
 		float dist2 = glm::dot(n, n);
 		float rSum = A.radius + B.radius;
 
@@ -91,7 +175,8 @@ class PhysicsEngine {
 		n = n / dist;
 
 		// contact point approximate: along normal from A
-		glm::vec3 contact = A.position + n * A.radius;
+		glm::vec3 contact = ca + n * A.radius;
+		if (recordContacts) contacts.push_back({contact, n, penetration});
 		glm::vec3 ra = contact - A.position;
 		glm::vec3 rb = contact - B.position;
 
@@ -155,6 +240,7 @@ class PhysicsEngine {
 		if (bottom < groundY) {
 			// penetration
 			float penetration = groundY - bottom;
+			if (recordContacts) contacts.push_back({glm::vec3(b.position.x, groundY, b.position.z), glm::vec3(0.0f, 1.0f, 0.0f), penetration});
 			// move object up
 			b.position.y += penetration + positionalCorrectionSlop;
 
@@ -4,21 +4,571 @@
 #include "oglprojs.h"
 
 #include "oglproj3.h"
+#include "oglprojs_parallel.h"
+#include "oglprojs_simd.h"
 
+#include <bit>
+#include <cassert>
+#include <limits>
+#include <numeric>
+#include <queue>
 #include <random>
+#include <tuple>
 
 namespace oglprojs {
+// Uniform grid over the bounding box of a point set, rebuilt with a counting sort.
+// The sort is stable, so points of one cell stay in index order.
+struct UniformGrid {
+	glm::vec3 origin{0.0f};
+	float cellSize = 1.0f;
+	glm::ivec3 dims{1};
+	std::vector<unsigned> cellStart; // cells + 1 offsets into indices
+	std::vector<unsigned> indices;   // point indices sorted by cell
+	std::vector<unsigned> cellOf;    // cell of each point
+
+	// minCell must be >= the query radius; it is enlarged when the box would need more than maxCellsPerPoint * n cells
+	template <typename PosFn> void build(size_t n, float minCell, PosFn pos, float maxCellsPerPoint = 2.0f) {
+		glm::vec3 mn(0.0f), mx(0.0f);
+		if (n > 0) mn = mx = pos(0);
+		for (size_t i = 1; i < n; i++) {
+			glm::vec3 p = pos(i);
+			mn = glm::min(mn, p);
+			mx = glm::max(mx, p);
+		}
+
+		cellSize = std::max(minCell, 1e-4f);
+		glm::vec3 extent = mx - mn;
+		double maxCells = std::max(1.0, double(n) * maxCellsPerPoint);
+		auto cellsFor = [&](float c) {
+			glm::dvec3 d = glm::floor(glm::dvec3(extent) / double(c)) + 1.0;
+			return d.x * d.y * d.z;
+		};
+		double total = cellsFor(cellSize);
+		if (total > maxCells) cellSize *= float(std::cbrt(total / maxCells)) * 1.001f;
+		origin = mn;
+		dims = glm::ivec3(glm::floor(extent / cellSize)) + 1;
+
+		size_t numCells = size_t(dims.x) * dims.y * dims.z;
+		cellStart.assign(numCells + 1, 0);
+		cellOf.resize(n);
+		indices.resize(n);
+		for (size_t i = 0; i < n; i++) {
+			glm::ivec3 c = cellCoord(pos(i));
+			cellOf[i] = unsigned((c.z * dims.y + c.y) * dims.x + c.x);
+			cellStart[cellOf[i] + 1]++;
+		}
+		for (size_t c = 0; c < numCells; c++) cellStart[c + 1] += cellStart[c];
+		cursor.assign(cellStart.begin(), cellStart.end() - 1);
+		for (size_t i = 0; i < n; i++) indices[cursor[cellOf[i]]++] = unsigned(i);
+	}
+
+	glm::ivec3 cellCoord(const glm::vec3 &p) const { return glm::clamp(glm::ivec3(glm::floor((p - origin) / cellSize)), glm::ivec3(0), dims - 1); }
+
+	// visit the 27 cells around p as (at most 9) contiguous ranges [begin, end) of the sorted order
+	template <typename Fn> void forEachNearRange(const glm::vec3 &p, Fn fn) const {
+		glm::ivec3 c = cellCoord(p);
+		glm::ivec3 lo = glm::max(c - 1, glm::ivec3(0)), hi = glm::min(c + 1, dims - 1);
+		for (int z = lo.z; z <= hi.z; z++)
+			for (int y = lo.y; y <= hi.y; y++) {
+				unsigned row = unsigned((z * dims.y + y) * dims.x);
+				unsigned begin = cellStart[row + lo.x], end = cellStart[row + hi.x + 1];
+				if (begin < end) fn(begin, end);
+			}
+	}
+
+	size_t memoryBytes() const {
+		return (cellStart.capacity() + indices.capacity() + cellOf.capacity() + cursor.capacity()) * sizeof(unsigned);
+	}
+
+	// outline every occupied cell (debug overlay)
+	void debugDraw(DebugDraw &dd, const glm::vec4 &color) const {
+		for (int z = 0; z < dims.z; z++)
+			for (int y = 0; y < dims.y; y++)
+				for (int x = 0; x < dims.x; x++) {
+					size_t c = size_t((z * dims.y + y) * dims.x + x);
+					if (c + 1 >= cellStart.size() || cellStart[c] == cellStart[c + 1]) continue;
+					glm::vec3 lo = origin + glm::vec3(x, y, z) * cellSize;
+					dd.box(lo, lo + cellSize, color);
+				}
+	}
+
+	// visit every point in the 27 cells around p
+	template <typename Fn> void forEachNear(const glm::vec3 &p, Fn fn) const {
+		forEachNearRange(p, [&](unsigned begin, unsigned end) {
+			for (unsigned k = begin; k < end; k++) fn(indices[k]);
+		});
+	}
+
+  private:
+	std::vector<unsigned> cursor; // counting sort write positions
+};
+
+// Implicit KD-tree over a point set, rebuilt per frame. The node of range [b, e) is its median m = (b + e) / 2,
+// split on axis[m] (the widest axis of the range); its children are [b, m) and [m + 1, e).
+// The top levels are split on the calling thread and the remaining subtrees are built in parallel;
+// every node is split the same way whichever thread builds it, so the tree does not depend on the pool.
+struct KDTree {
+	static constexpr size_t maxK = 32;
+
+	std::vector<float> x, y, z;    // points in tree order
+	std::vector<unsigned> indices; // tree order -> point index
+	std::vector<uint8_t> axis;     // split axis of each node
+
+	template <typename PosFn> void build(size_t n, PosFn pos, ThreadPool *pool = nullptr) {
+		items.resize(n);
+		for (size_t i = 0; i < n; i++) {
+			glm::vec3 p = pos(i);
+			items[i] = {p.x, p.y, p.z, unsigned(i)};
+		}
+		axis.assign(n, 0);
+
+		// split serially until there are enough independent subtrees to keep the pool busy
+		size_t tasks = pool ? size_t(pool->size()) * 8 : 1;
+		std::vector<std::pair<size_t, size_t>> ranges{{0, n}}, next;
+		while (ranges.size() < tasks) {
+			next.clear();
+			for (auto [b, e] : ranges) {
+				if (e - b < 2048) {
+					next.push_back({b, e});
+					continue;
+				}
+				size_t m = splitNode(b, e);
+				next.push_back({b, m});
+				next.push_back({m + 1, e});
+			}
+			if (next.size() == ranges.size()) break;
+			ranges.swap(next);
+		}
+		parallelFor(pool, 0, ranges.size(), 1, [&](size_t rb, size_t re) {
+			for (size_t r = rb; r < re; r++) buildRange(ranges[r].first, ranges[r].second);
+		});
+
+		x.resize(n), y.resize(n), z.resize(n), indices.resize(n);
+		for (size_t t = 0; t < n; t++) x[t] = items[t].x, y[t] = items[t].y, z[t] = items[t].z, indices[t] = items[t].index;
+	}
+
+	// up to k (<= maxK) nearest points to p within sqrt(maxDist2), skipping point index self;
+	// writes tree positions and squared distances in ascending distance, returns the number found
+	size_t nearest(const glm::vec3 &p, unsigned self, size_t k, unsigned *out, float *outDist2,
+	               float maxDist2 = std::numeric_limits<float>::infinity()) const {
+		Knn knn{out, outDist2, std::min(k, maxK), 0, maxDist2};
+		if (knn.k > 0) search(0, indices.size(), p, self, knn);
+		return knn.size;
+	}
+
+	size_t memoryBytes() const {
+		return (x.capacity() + y.capacity() + z.capacity()) * sizeof(float) + indices.capacity() * sizeof(unsigned) + axis.capacity() +
+		       items.capacity() * sizeof(Item);
+	}
+
+  private:
+	struct Item {
+		float x, y, z;
+		unsigned index;
+		float coord(int a) const { return a == 0 ? x : a == 1 ? y : z; }
+	};
+	std::vector<Item> items; // build scratch
+
+	// partition [b, e) around its median on the widest axis; returns the median position
+	size_t splitNode(size_t b, size_t e) {
+		glm::vec3 mn(items[b].x, items[b].y, items[b].z), mx = mn;
+		for (size_t t = b + 1; t < e; t++) {
+			glm::vec3 q(items[t].x, items[t].y, items[t].z);
+			mn = glm::min(mn, q);
+			mx = glm::max(mx, q);
+		}
+		glm::vec3 ext = mx - mn;
+		int a = ext.x >= ext.y && ext.x >= ext.z ? 0 : ext.y >= ext.z ? 1 : 2;
+		size_t m = (b + e) / 2;
+		std::nth_element(items.begin() + b, items.begin() + m, items.begin() + e, [a](const Item &l, const Item &r) {
+			return l.coord(a) < r.coord(a) || (l.coord(a) == r.coord(a) && l.index < r.index);
+		});
+		axis[m] = uint8_t(a);
+		return m;
+	}
+
+	void buildRange(size_t b, size_t e) {
+		while (e - b > 1) {
+			size_t m = splitNode(b, e);
+			buildRange(b, m);
+			b = m + 1;
+		}
+	}
+
+	// bounded max-list of the best candidates so far, kept sorted by distance
+	struct Knn {
+		unsigned *node;
+		float *dist2;
+		size_t k, size;
+		float maxDist2;
+
+		float worst() const { return size < k ? maxDist2 : dist2[k - 1]; }
+		void push(unsigned t, float d2) {
+			if (d2 >= worst()) return;
+			size_t j = size < k ? size++ : k - 1;
+			for (; j > 0 && dist2[j - 1] > d2; j--) node[j] = node[j - 1], dist2[j] = dist2[j - 1];
+			node[j] = t, dist2[j] = d2;
+		}
+	};
+
+	void search(size_t b, size_t e, const glm::vec3 &p, unsigned self, Knn &knn) const {
+		while (b < e) {
+			size_t m = (b + e) / 2;
+			glm::vec3 q(x[m], y[m], z[m]);
+			glm::vec3 d = p - q;
+			if (indices[m] != self) knn.push(unsigned(m), glm::dot(d, d));
+			float delta = d[axis[m]];
+			// nearer child first, then the far one only if the splitting plane is closer than the current worst
+			if (delta < 0.0f) {
+				search(b, m, p, self, knn);
+				if (delta * delta >= knn.worst()) return;
+				b = m + 1;
+			} else {
+				search(m + 1, e, p, self, knn);
+				if (delta * delta >= knn.worst()) return;
+				e = m;
+			}
+		}
+	}
+};
+
+// Octree whose nodes carry aggregates (count, position and velocity sums) of the points below them,
+// for Barnes-Hut style far-field sums. Nodes are cubes split at their center down to leafSize points.
+// With groups > 1 every node also keeps the aggregates of each group (e.g. flock species) separately.
+struct Octree {
+	struct Node {
+		glm::vec3 center;
+		float halfSize;
+		glm::vec3 sumPos;
+		float count;
+		glm::vec3 sumVel;
+		unsigned begin, end; // points [begin, end) in tree order
+		int child[8];        // node index or -1; all -1 for leaves
+
+		bool leaf() const {
+			for (int c : child)
+				if (c >= 0) return false;
+			return true;
+		}
+	};
+
+	std::vector<Node> nodes;                   // nodes[0] is the root
+	std::vector<float> x, y, z, vx, vy, vz;    // points in tree order
+	std::vector<unsigned> indices;             // tree order -> point index
+	std::vector<uint8_t> group;                // tree order -> group
+	std::vector<glm::vec3> groupPos, groupVel; // groups > 1: per node and group, at node * groups + group
+	std::vector<float> groupCount;
+	int groups = 1;
+	size_t leafSize = 8;
+	static constexpr int maxDepth = 20; // stops splitting coincident points
+
+	template <typename PosFn, typename VelFn> void build(size_t n, PosFn pos, VelFn vel) {
+		build(n, pos, vel, [](size_t) { return 0; }, 1);
+	}
+
+	template <typename PosFn, typename VelFn, typename GroupFn> void build(size_t n, PosFn pos, VelFn vel, GroupFn groupOf, int numGroups) {
+		groups = std::max(numGroups, 1);
+		groupPos.clear(), groupVel.clear(), groupCount.clear();
+		items.resize(n);
+		glm::vec3 mn(0.0f), mx(0.0f);
+		for (size_t i = 0; i < n; i++) {
+			items[i] = {pos(i), vel(i), unsigned(i), uint8_t(groupOf(i))};
+			mn = i == 0 ? items[i].p : glm::min(mn, items[i].p);
+			mx = i == 0 ? items[i].p : glm::max(mx, items[i].p);
+		}
+		nodes.clear();
+		if (n == 0) return;
+		glm::vec3 ext = mx - mn;
+		buildNode(0, unsigned(n), (mn + mx) * 0.5f, std::max(std::max(ext.x, ext.y), std::max(ext.z, 1e-4f)) * 0.5f, 0);
+
+		x.resize(n), y.resize(n), z.resize(n), vx.resize(n), vy.resize(n), vz.resize(n), indices.resize(n), group.resize(n);
+		for (size_t t = 0; t < n; t++) {
+			const Item &it = items[t];
+			x[t] = it.p.x, y[t] = it.p.y, z[t] = it.p.z;
+			vx[t] = it.v.x, vy[t] = it.v.y, vz[t] = it.v.z;
+			indices[t] = it.index;
+			group[t] = it.group;
+		}
+	}
+
+	size_t memoryBytes() const {
+		size_t cols = x.capacity() + y.capacity() + z.capacity() + vx.capacity() + vy.capacity() + vz.capacity();
+		return nodes.capacity() * sizeof(Node) + cols * sizeof(float) + indices.capacity() * sizeof(unsigned) + group.capacity() +
+		       (groupPos.capacity() + groupVel.capacity()) * sizeof(glm::vec3) + groupCount.capacity() * sizeof(float) +
+		       items.capacity() * sizeof(Item);
+	}
+
+  private:
+	struct Item {
+		glm::vec3 p, v;
+		unsigned index;
+		uint8_t group;
+	};
+	std::vector<Item> items; // build scratch
+
+	int buildNode(unsigned b, unsigned e, const glm::vec3 &center, float half, int depth) {
+		int idx = int(nodes.size());
+		Node node{center, half, glm::vec3(0.0f), float(e - b), glm::vec3(0.0f), b, e, {-1, -1, -1, -1, -1, -1, -1, -1}};
+		for (unsigned t = b; t < e; t++) node.sumPos += items[t].p, node.sumVel += items[t].v;
+		nodes.push_back(node);
+		if (groups > 1) {
+			size_t g0 = groupPos.size();
+			groupPos.resize(g0 + groups, glm::vec3(0.0f)), groupVel.resize(g0 + groups, glm::vec3(0.0f)), groupCount.resize(g0 + groups, 0.0f);
+			for (unsigned t = b; t < e; t++) {
+				size_t g = g0 + items[t].group;
+				groupPos[g] += items[t].p, groupVel[g] += items[t].v, groupCount[g] += 1.0f;
+			}
+		}
+		if (e - b <= leafSize || depth >= maxDepth) return idx;
+
+		// partition by x, then y, then z into 8 contiguous octant ranges (octant bit 0 = x, 1 = y, 2 = z)
+		auto first = items.begin();
+		unsigned bounds[9];
+		bounds[0] = b, bounds[8] = e;
+		auto split = [&](unsigned lo, unsigned hi, int a) {
+			return unsigned(std::partition(first + lo, first + hi, [&](const Item &it) { return it.p[a] < center[a]; }) - first);
+		};
+		bounds[4] = split(b, e, 2);
+		bounds[2] = split(b, bounds[4], 1), bounds[6] = split(bounds[4], e, 1);
+		for (int o = 0; o < 8; o += 2) bounds[o + 1] = split(bounds[o], bounds[o + 2], 0);
+
+		for (int o = 0; o < 8; o++) {
+			if (bounds[o] == bounds[o + 1]) continue;
+			glm::vec3 c = center + glm::vec3(o & 1 ? 0.5f : -0.5f, o & 2 ? 0.5f : -0.5f, o & 4 ? 0.5f : -0.5f) * half;
+			int ch = buildNode(bounds[o], bounds[o + 1], c, half * 0.5f, depth + 1);
+			nodes[idx].child[o] = ch;
+		}
+		return idx;
+	}
+};
+
+// 3D flow field baked over a box: per node, a guidance direction (shortest path to the nearest goal around obstacles,
+// or back toward the center outside worldRadius) and an avoidance vector (away from physics bodies, 1 at the surface
+// fading to 0 at margin). Boids sample it with trilinear interpolation, so the cost does not depend on the body count.
+// update() rebakes only the nodes around bodies that moved.
+struct FlowField {
+	glm::vec3 origin{0.0f};
+	float cellSize = 0.25f;
+	glm::ivec3 dims{2};
+	std::vector<float> gx, gy, gz;   // guidance (unit or zero)
+	std::vector<float> ax, ay, az;   // avoidance
+	std::vector<float> clearance;    // distance to the nearest body surface, minus boidRadius (< 0 = blocked)
+	std::vector<float> goalDistance; // path length to the nearest goal (infinity = unreachable)
+
+	std::vector<glm::vec3> goals;
+	float boidRadius = 0.08f;
+	float margin = 0.2f;      // avoidance reach beyond boidRadius (same as Flock's analytic avoidance)
+	float worldRadius = 0.0f; // > 0: guidance outside this radius points to the origin
+
+	// nodes every cellSize over [minCorner, maxCorner] (at least 2 per axis)
+	void init(const glm::vec3 &minCorner, const glm::vec3 &maxCorner, float cell) {
+		cellSize = std::max(cell, 1e-3f);
+		origin = minCorner;
+		dims = glm::max(glm::ivec3(glm::ceil((maxCorner - minCorner) / cellSize)) + 1, glm::ivec3(2));
+		size_t n = nodeCount();
+		for (auto *c : {&gx, &gy, &gz, &ax, &ay, &az, &goalDistance}) c->assign(n, 0.0f);
+		clearance.assign(n, std::numeric_limits<float>::infinity());
+		seen.clear();
+	}
+
+	size_t nodeCount() const { return size_t(dims.x) * dims.y * dims.z; }
+	size_t nodeIndex(int x, int y, int z) const { return (size_t(z) * dims.y + y) * dims.x + x; }
+	glm::vec3 nodePosition(int x, int y, int z) const { return origin + glm::vec3(x, y, z) * cellSize; }
+
+	// full bake: avoidance from every body, then guidance
+	void bake(const PhysicsEngine *physics) {
+		seen.clear();
+		if (physics)
+			for (const auto &b : physics->bodies) seen.push_back(snapshot(b));
+		bakeObstacles(glm::ivec3(0), dims - 1);
+		bakeGuidance();
+	}
+
+	// rebake around bodies that moved since the last bake; returns true if anything changed
+	bool update(const PhysicsEngine *physics) {
+		size_t bodies = physics ? physics->bodies.size() : 0;
+		if (bodies != seen.size()) {
+			bake(physics);
+			return true;
+		}
+		bool changed = false, blockedChanged = false;
+		for (size_t i = 0; i < bodies; i++) {
+			BodySnapshot now = snapshot(physics->bodies[i]);
+			if (now == seen[i]) continue;
+			glm::vec3 lo = glm::min(now.lo, seen[i].lo), hi = glm::max(now.hi, seen[i].hi);
+			seen[i] = now;
+			blockedChanged |= bakeObstacles(nodeBelow(lo), nodeAbove(hi));
+			changed = true;
+		}
+		if (blockedChanged && !goals.empty()) bakeGuidance(); // confinement does not depend on obstacles
+		return changed;
+	}
+
+	// trilinear samples of guidance and avoidance at p (clamped to the box)
+	void sample(const glm::vec3 &p, glm::vec3 &guide, glm::vec3 &avoid) const {
+		glm::vec3 f = glm::clamp((p - origin) / cellSize, glm::vec3(0.0f), glm::vec3(dims - 1));
+		glm::ivec3 i0 = glm::min(glm::ivec3(f), dims - 2);
+		glm::vec3 t = f - glm::vec3(i0);
+		guide = avoid = glm::vec3(0.0f);
+		for (int c = 0; c < 8; c++) {
+			glm::ivec3 o(c & 1, (c >> 1) & 1, (c >> 2) & 1);
+			float w = (o.x ? t.x : 1.0f - t.x) * (o.y ? t.y : 1.0f - t.y) * (o.z ? t.z : 1.0f - t.z);
+			size_t k = nodeIndex(i0.x + o.x, i0.y + o.y, i0.z + o.z);
+			guide += w * glm::vec3(gx[k], gy[k], gz[k]);
+			avoid += w * glm::vec3(ax[k], ay[k], az[k]);
+		}
+	}
+
+  private:
+	struct BodySnapshot {
+		glm::vec3 lo, hi; // bounds including the avoidance reach
+		glm::vec3 position, halfAxis;
+		float radius;
+		bool operator==(const BodySnapshot &o) const {
+			return position == o.position && halfAxis == o.halfAxis && radius == o.radius;
+		}
+	};
+	std::vector<BodySnapshot> seen; // bodies as of the last bake
+
+	BodySnapshot snapshot(const RigidBody &b) const {
+		glm::vec3 h = b.shape == RigidBody::CAPSULE ? glm::abs(b.halfAxis) : glm::vec3(0.0f);
+		glm::vec3 r(b.radius + boidRadius + margin);
+		return {b.position - h - r, b.position + h + r, b.position, b.shape == RigidBody::CAPSULE ? b.halfAxis : glm::vec3(0.0f),
+		        b.radius};
+	}
+
+	glm::ivec3 nodeBelow(const glm::vec3 &p) const { return glm::clamp(glm::ivec3(glm::floor((p - origin) / cellSize)), glm::ivec3(0), dims - 1); }
+	glm::ivec3 nodeAbove(const glm::vec3 &p) const { return glm::clamp(glm::ivec3(glm::ceil((p - origin) / cellSize)), glm::ivec3(0), dims - 1); }
+
+	// recompute avoidance and clearance for nodes in [lo, hi] from every body; returns true if a node's blocked state flipped
+	bool bakeObstacles(const glm::ivec3 &lo, const glm::ivec3 &hi) {
+		bool flipped = false;
+		for (int z = lo.z; z <= hi.z; z++)
+			for (int y = lo.y; y <= hi.y; y++)
+				for (int x = lo.x; x <= hi.x; x++) {
+					glm::vec3 p = nodePosition(x, y, z);
+					glm::vec3 avoid(0.0f);
+					float clear = std::numeric_limits<float>::infinity();
+					for (const BodySnapshot &b : seen) {
+						if (glm::any(glm::lessThan(p, b.lo)) || glm::any(glm::greaterThan(p, b.hi))) continue;
+						float len2 = glm::dot(b.halfAxis, b.halfAxis);
+						float t = len2 > 0.0f ? glm::clamp(glm::dot(p - b.position, b.halfAxis) / len2, -1.0f, 1.0f) : 0.0f;
+						glm::vec3 away = p - (b.position + b.halfAxis * t);
+						float d = glm::length(away);
+						float reach = b.radius + boidRadius + margin;
+						clear = std::min(clear, d - b.radius - boidRadius);
+						if (d < reach && d > 0.01f) avoid += away * ((reach - d) / (reach * d));
+					}
+					size_t k = nodeIndex(x, y, z);
+					flipped |= (clearance[k] < 0.0f) != (clear < 0.0f);
+					ax[k] = avoid.x, ay[k] = avoid.y, az[k] = avoid.z;
+					clearance[k] = clear;
+				}
+		return flipped;
+	}
+
+	// Dijkstra from the goal nodes over the 26-neighborhood (blocked nodes excluded), then point every node
+	// at its lowest-distance neighbor; nodes outside worldRadius point to the origin instead
+	void bakeGuidance() {
+		const float inf = std::numeric_limits<float>::infinity();
+		std::fill(goalDistance.begin(), goalDistance.end(), inf);
+		using Entry = std::pair<float, size_t>;
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+		for (const glm::vec3 &g : goals) {
+			glm::ivec3 c = glm::clamp(glm::ivec3(glm::round((g - origin) / cellSize)), glm::ivec3(0), dims - 1);
+			size_t k = nodeIndex(c.x, c.y, c.z);
+			if (clearance[k] < 0.0f) continue;
+			goalDistance[k] = 0.0f;
+			open.push({0.0f, k});
+		}
+		auto coords = [&](size_t k) { return glm::ivec3(int(k % dims.x), int(k / dims.x % dims.y), int(k / (size_t(dims.x) * dims.y))); };
+		while (!open.empty()) {
+			auto [d, k] = open.top();
+			open.pop();
+			if (d > goalDistance[k]) continue;
+			glm::ivec3 c = coords(k);
+			forEachNeighbor(c, [&](const glm::ivec3 &nc, float step) {
+				size_t nk = nodeIndex(nc.x, nc.y, nc.z);
+				if (clearance[nk] < 0.0f) return;
+				float nd = d + step * cellSize;
+				if (nd < goalDistance[nk]) {
+					goalDistance[nk] = nd;
+					open.push({nd, nk});
+				}
+			});
+		}
+
+		for (int z = 0; z < dims.z; z++)
+			for (int y = 0; y < dims.y; y++)
+				for (int x = 0; x < dims.x; x++) {
+					size_t k = nodeIndex(x, y, z);
+					glm::vec3 p = nodePosition(x, y, z);
+					glm::vec3 dir(0.0f);
+					if (worldRadius > 0.0f && glm::dot(p, p) > worldRadius * worldRadius) {
+						dir = -glm::normalize(p);
+					} else if (goalDistance[k] > 0.0f && goalDistance[k] < inf) {
+						float best = goalDistance[k];
+						forEachNeighbor(glm::ivec3(x, y, z), [&](const glm::ivec3 &nc, float) {
+							float nd = goalDistance[nodeIndex(nc.x, nc.y, nc.z)];
+							if (nd < best) best = nd, dir = glm::normalize(glm::vec3(nc - glm::ivec3(x, y, z)));
+						});
+					}
+					gx[k] = dir.x, gy[k] = dir.y, gz[k] = dir.z;
+				}
+	}
+
+	// fn(neighbor, step length in cells) for the in-bounds 26-neighborhood of c
+	template <typename Fn> void forEachNeighbor(const glm::ivec3 &c, Fn fn) const {
+		static const float steps[4] = {0.0f, 1.0f, 1.41421356f, 1.73205081f};
+		for (int dz = -1; dz <= 1; dz++)
+			for (int dy = -1; dy <= 1; dy++)
+				for (int dx = -1; dx <= 1; dx++) {
+					glm::ivec3 n = c + glm::ivec3(dx, dy, dz);
+					if ((dx | dy | dz) == 0 || glm::any(glm::lessThan(n, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(n, dims))) continue;
+					fn(n, steps[std::abs(dx) + std::abs(dy) + std::abs(dz)]);
+				}
+	}
+};
+
+// Value view of a single boid (the flock itself stores columns, see Flock)
 struct Boid {
 	glm::vec3 position = glm::vec3(0.0f);
 	glm::vec3 velocity = glm::vec3(0.0f);
-	glm::vec3 acceleration = glm::vec3(0.0f);
 
 	float radius = 0.08f;  // visual radius
 	float maxSpeed = 3.0f; // units per second
 	float maxForce = 6.0f; // steering accel magnitude
 };
 
+// Packed per-boid instance data, laid out for a GL instance buffer (two vec4 attributes)
+struct BoidInstance {
+	glm::vec4 positionScale; // xyz = position, w = uniform scale
+	glm::vec4 rotation;      // unit quaternion (x, y, z, w) turning +Z toward the velocity, no roll
+};
+
 class Flock {
+  public:
+	// per-species weights; one contiguous block per species in speciesParams
+	struct Species {
+		float wSeparation = 1.6f;
+		float wAlignment = 1.0f;
+		float wCohesion = 1.0f;
+		float wWander = 0.25f;
+		float wAvoid = 2.5f;
+	};
+	// how a boid reacts to neighbors of another species: factors on its own separation/alignment/cohesion weights
+	// (negative cohesion flees them)
+	struct Interaction {
+		float separation = 1.0f;
+		float alignment = 1.0f;
+		float cohesion = 1.0f;
+	};
+	static constexpr int maxSpecies = 4;
+
+  protected:
+	using f8 = simd::f8;
+	using v3x8 = simd::v3x8;
+
 	// Helpers
 	static glm::vec3 limitMagnitude(const glm::vec3 &v, float maxMag) {
 		float len2 = glm::dot(v, v);
@@ -30,17 +580,721 @@ class Flock {
 		if (l < 1e-6f) return glm::vec3(0.0f);
 		return v * (mag / l);
 	}
+	// 8-lane versions of the helpers above
+	static v3x8 limitMagnitude(const v3x8 &v, f8 maxMag) {
+		f8 len2 = simd::dot(v, v);
+		return simd::select(len2 > maxMag * maxMag, v * (maxMag / simd::sqrt(len2)), v);
+	}
+	static v3x8 setMagnitude(const v3x8 &v, f8 mag) {
+		f8 l = simd::sqrt(simd::dot(v, v));
+		return simd::select(l < f8(1e-6f), v3x8(0.0f, 0.0f, 0.0f), v * (mag / l));
+	}
 
-	// RNG for wander
+	// RNG for initial placement; wander uses counter-based streams keyed by (seed, boid, frame)
 	std::mt19937 rng;
 	std::uniform_real_distribution<float> uni;
+	unsigned int seed;
+	uint64_t frame = 0;
+
+	// per-update scratch columns (padded like the boid columns); sums, draws and outputs are indexed by slot,
+	// which is the boid index in a full update and the position in the LOD list otherwise.
+	// Neighbor sums are kept per neighbor species: the sums over species s start at s * stride.
+	struct Scratch {
+		std::vector<float> sx, sy, sz, svx, svy, svz, ssp;                    // cell-sorted copies of position/velocity/species
+		std::vector<float> posX, posY, posZ, velX, velY, velZ, sepX, sepY, sepZ; // neighbor sums
+		std::vector<float> nCount, sCount;                                      // neighbor / separation counts
+		std::vector<float> rndX, rndY, rndZ;                                    // wander draws
+		std::vector<float> wpx, wpy, wpz, wvx, wvy, wvz, wms, wmf, wsp;         // LOD: packed copies of the selected boids
+		std::vector<float> outX, outY, outZ;                                    // LOD: steering of the selected boids
+		std::vector<unsigned> rank;                                             // boid -> position in cell order
+		std::vector<unsigned> slots;                                            // LOD: selected boids, ascending
+		size_t stride = 0;
+
+		void resize(size_t padded, int species) {
+			stride = padded;
+			for (auto *c : {&sx, &sy, &sz, &svx, &svy, &svz, &ssp, &rndX, &rndY, &rndZ, &wpx, &wpy, &wpz, &wvx, &wvy, &wvz, &wms, &wmf, &wsp,
+			                &outX, &outY, &outZ})
+				c->assign(padded, 0.0f);
+			for (auto *c : {&posX, &posY, &posZ, &velX, &velY, &velZ, &sepX, &sepY, &sepZ, &nCount, &sCount})
+				c->assign(padded * species, 0.0f);
+			rank.assign(padded, 0);
+		}
+	} scratch;
+
+	// steering of the last time each boid was evaluated (LOD reuses it between refreshes)
+	std::vector<float> steerX, steerY, steerZ;
+	std::vector<uint32_t> lodAge; // updates since the boid's steering was recomputed
+	bool steerValid = false;
+	size_t lodCursor = 0;
+	size_t evaluated = 0; // boids whose neighbor sums the last update computed (slots [0, evaluated))
+
+	UniformGrid grid;
+	KDTree kdtree;
+	Octree octree;
+	size_t count = 0;
+
+	// Verlet mode: per boid, the boids within the cutoff (perception radius + verletSkin) at the last rebuild
+	std::vector<unsigned> verletStart;            // count + 1 offsets into verletList by cell order (empty = not built)
+	std::vector<unsigned> verletList;             // neighbors as positions in the cell order of the rebuild
+	std::vector<float> verletX, verletY, verletZ; // positions at the last rebuild, by boid
+	std::vector<float> verletBoids;               // x, y, z, vx, vy, vz, species, 0 per cell-order entry: one load per neighbor
+	float verletCutoff = 0.0f;
+	std::vector<std::vector<unsigned>> verletParts; // rebuild: the lists found by each chunk, reused across rebuilds
+	size_t verletBuilds = 0;
+
+	// species: boids are sorted by species, species s owns [speciesStart[s], speciesStart[s + 1])
+	std::vector<float> speciesId; // per boid, as float for the 8-lane compares
+	std::vector<size_t> speciesStart{0, 0};
+
+	int speciesCount() const { return int(speciesStart.size()) - 1; }
+
+	// every boid's speciesId names the species block holding it (the gathers read the id, the weights use the block)
+	bool speciesIdsMatchBlocks() const {
+		for (int t = 0; t < speciesCount(); t++)
+			for (size_t i = speciesStart[t]; i < speciesStart[t + 1]; i++)
+				if (speciesId[i] != float(t)) return false;
+		return true;
+	}
+	size_t steeredCount() const { return std::min(activeCount, count); }
+
+	// weights of species s (the flock-wide weights while no species were added)
+	Species speciesWeights(int s) const {
+		if (speciesParams.empty()) return {wSeparation, wAlignment, wCohesion, wWander, wAvoid};
+		return speciesParams[s];
+	}
+
+	// columns the steering kernel reads: the flock itself, or packed copies of the LOD selection
+	struct BoidColumns {
+		const float *px, *py, *pz, *vx, *vy, *vz, *maxSpeed, *maxForce, *species;
+	};
+	BoidColumns flockColumns() const {
+		return {px.data(), py.data(), pz.data(), vx.data(), vy.data(), vz.data(), maxSpeed.data(), maxForce.data(), speciesId.data()};
+	}
+	BoidColumns packedColumns() const {
+		const Scratch &s = scratch;
+		return {s.wpx.data(), s.wpy.data(), s.wpz.data(), s.wvx.data(), s.wvy.data(), s.wvz.data(), s.wms.data(), s.wmf.data(), s.wsp.data()};
+	}
+
+	// neighbor accumulation of boid (bx,by,bz) over columns [begin, end), skipping index self; 8 candidates per iteration.
+	// acc[s] collects the neighbors of species s (sp holds the candidates' species when there is more than one)
+	struct NeighborAcc {
+		v3x8 pos{0.0f, 0.0f, 0.0f}, vel{0.0f, 0.0f, 0.0f}, sep{0.0f, 0.0f, 0.0f};
+		f8 n = 0.0f, ns = 0.0f;
+	};
+	void accumulateRange(const float *x, const float *y, const float *z, const float *vx_, const float *vy_, const float *vz_,
+	                     const float *sp, size_t begin, size_t end, size_t self, const v3x8 &b, NeighborAcc *acc) const {
+		const f8 neighR2 = neighborRadius * neighborRadius;
+		const f8 sepR2 = separationRadius * separationRadius;
+		const f8 fend = float(end), fself = float(self), zero = 0.0f, one = 1.0f;
+		const int species = speciesCount();
+		for (size_t k = begin; k < end; k += 8) {
+			f8 idx = f8(float(k)) + f8::iota();
+			f8 valid = (idx < fend) & (idx != fself);
+			v3x8 o = v3x8::load(x + k, y + k, z + k);
+			v3x8 diff = o - b;
+			f8 dist2 = simd::dot(diff, diff);
+			v3x8 vel = v3x8::load(vx_ + k, vy_ + k, vz_ + k);
+			// repulsive vector (away from neighbor) scaled by inverse distance: normalize(away) / d = away / d^2
+			v3x8 away = (b - o) * (one / dist2);
+			f8 inN = valid & (dist2 < neighR2);
+			f8 inS = valid & (dist2 < sepR2) & (dist2 > f8(0.00001f));
+
+			auto add = [&](NeighborAcc &a, f8 n, f8 s) {
+				a.pos += simd::select(n, o, v3x8(zero, zero, zero));
+				a.vel += simd::select(n, vel, v3x8(zero, zero, zero));
+				a.n += simd::select(n, one, zero);
+				a.sep += simd::select(s, away, v3x8(zero, zero, zero));
+				a.ns += simd::select(s, one, zero);
+			};
+			if (species == 1) {
+				add(acc[0], inN, inS);
+				continue;
+			}
+			f8 spc = f8::load(sp + k);
+			for (int t = 0; t < species; t++) {
+				f8 is = spc == f8(float(t));
+				add(acc[t], inN & is, inS & is);
+			}
+		}
+	}
+
+	// neighbor sums of one species for the scalar (tree) searches
+	struct ScalarSums {
+		glm::vec3 pos{0.0f}, vel{0.0f}, sep{0.0f};
+		float n = 0.0f, ns = 0.0f;
+	};
+
+	// sums over the k nearest boids of boid i, stored at slot
+	void accumulateNearest(size_t i, size_t slot, size_t k) {
+		unsigned nb[KDTree::maxK];
+		float d2[KDTree::maxK];
+		glm::vec3 b = position(i);
+		size_t found = kdtree.nearest(b, unsigned(i), k, nb, d2);
+		const float sepR2 = separationRadius * separationRadius;
+		ScalarSums sums[maxSpecies];
+		for (size_t j = 0; j < found; j++) {
+			unsigned t = nb[j], o = kdtree.indices[t];
+			ScalarSums &a = sums[int(speciesId[o])];
+			glm::vec3 q(kdtree.x[t], kdtree.y[t], kdtree.z[t]);
+			a.pos += q;
+			a.vel += velocity(o);
+			a.n += 1.0f;
+			// separation keeps its metric radius, limited to the k neighbors
+			if (d2[j] < sepR2 && d2[j] > 0.00001f) {
+				a.sep += (b - q) / d2[j];
+				a.ns += 1.0f;
+			}
+		}
+		storeSums(slot, sums);
+	}
+
+	// sums for boid i from the octree, stored at slot: separation is exact, alignment/cohesion take a whole node when it
+	// lies inside neighborRadius, or when it is far enough (size / distance < barnesHutTheta) and its centroid is in range
+	void accumulateOctree(size_t i, size_t slot) {
+		const float neighR2 = neighborRadius * neighborRadius, sepR2 = separationRadius * separationRadius;
+		const float reach2 = std::max(neighR2, sepR2), theta2 = barnesHutTheta * barnesHutTheta;
+		glm::vec3 b = position(i);
+		const int species = speciesCount();
+		ScalarSums sums[maxSpecies];
+		auto addNode = [&](int idx, const Octree::Node &node) {
+			if (species == 1) {
+				sums[0].pos += node.sumPos, sums[0].vel += node.sumVel, sums[0].n += node.count;
+				return;
+			}
+			for (int t = 0; t < species; t++) {
+				size_t g = size_t(idx) * species + t;
+				sums[t].pos += octree.groupPos[g], sums[t].vel += octree.groupVel[g], sums[t].n += octree.groupCount[g];
+			}
+		};
+
+		int stack[7 * Octree::maxDepth + 8];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			int idx = stack[--top];
+			const Octree::Node &node = octree.nodes[idx];
+			glm::vec3 d = glm::max(glm::abs(b - node.center) - node.halfSize, glm::vec3(0.0f));
+			float dmin2 = glm::dot(d, d);
+			if (dmin2 >= reach2) continue;
+			glm::vec3 f = glm::abs(b - node.center) + node.halfSize;
+			float dmax2 = glm::dot(f, f);
+			bool nearSep = dmin2 < sepR2;
+
+			if (!nearSep && dmax2 < neighR2) {
+				// entirely inside the neighbor sphere: exact
+				addNode(idx, node);
+				continue;
+			}
+			if (!nearSep) {
+				glm::vec3 c = node.sumPos / node.count - b;
+				float dc2 = glm::dot(c, c);
+				float size = 2.0f * node.halfSize;
+				if (size * size < theta2 * dc2) {
+					if (dc2 < neighR2) addNode(idx, node);
+					continue;
+				}
+			}
+			if (node.leaf()) {
+				for (unsigned t = node.begin; t < node.end; t++) {
+					if (octree.indices[t] == i) continue;
+					ScalarSums &a = sums[octree.group[t]];
+					glm::vec3 q(octree.x[t], octree.y[t], octree.z[t]);
+					glm::vec3 diff = q - b;
+					float dist2 = glm::dot(diff, diff);
+					if (dist2 < neighR2) {
+						a.pos += q, a.vel += glm::vec3(octree.vx[t], octree.vy[t], octree.vz[t]);
+						a.n += 1.0f;
+					}
+					if (dist2 < sepR2 && dist2 > 0.00001f) {
+						a.sep += (b - q) / dist2;
+						a.ns += 1.0f;
+					}
+				}
+				continue;
+			}
+			for (int c : node.child)
+				if (c >= 0) stack[top++] = c;
+		}
+		storeSums(slot, sums);
+	}
+
+	void storeSums(size_t slot, const NeighborAcc *acc) {
+		Scratch &s = scratch;
+		for (int t = 0; t < speciesCount(); t++) {
+			const NeighborAcc &a = acc[t];
+			size_t i = t * s.stride + slot;
+			s.posX[i] = simd::hsum(a.pos.x), s.posY[i] = simd::hsum(a.pos.y), s.posZ[i] = simd::hsum(a.pos.z);
+			s.velX[i] = simd::hsum(a.vel.x), s.velY[i] = simd::hsum(a.vel.y), s.velZ[i] = simd::hsum(a.vel.z);
+			s.sepX[i] = simd::hsum(a.sep.x), s.sepY[i] = simd::hsum(a.sep.y), s.sepZ[i] = simd::hsum(a.sep.z);
+			s.nCount[i] = simd::hsum(a.n);
+			s.sCount[i] = simd::hsum(a.ns);
+		}
+	}
+	void storeSums(size_t slot, const ScalarSums *sums) {
+		Scratch &s = scratch;
+		for (int t = 0; t < speciesCount(); t++) {
+			const ScalarSums &a = sums[t];
+			size_t i = t * s.stride + slot;
+			s.posX[i] = a.pos.x, s.posY[i] = a.pos.y, s.posZ[i] = a.pos.z;
+			s.velX[i] = a.vel.x, s.velY[i] = a.vel.y, s.velZ[i] = a.vel.z;
+			s.sepX[i] = a.sep.x, s.sepY[i] = a.sep.y, s.sepZ[i] = a.sep.z;
+			s.nCount[i] = a.n;
+			s.sCount[i] = a.ns;
+		}
+	}
+
+	// the Verlet lists are stale when built for another cutoff or when any boid moved more than half the skin since:
+	// two boids can then have closed in by more than the skin, so a neighbor may be missing from a list
+	bool verletStale(float cutoff) const {
+		if (verletStart.size() != count + 1 || cutoff != verletCutoff) return true;
+		const float limit2 = 0.25f * verletSkin * verletSkin;
+		for (size_t i = 0; i < count; i++) {
+			float dx = px[i] - verletX[i], dy = py[i] - verletY[i], dz = pz[i] - verletZ[i];
+			if (dx * dx + dy * dy + dz * dz > limit2) return true;
+		}
+		return false;
+	}
+
+	// rebuild the lists from a grid with cell = cutoff. Lists are kept in cell order and hold cell-order positions,
+	// so a walk gathers from nearby entries of the sorted copies; chunks fill their own part, concatenated in order.
+	void buildVerlet(float cutoff) {
+		Scratch &s = scratch;
+		grid.build(count, cutoff, [&](size_t i) { return position(i); });
+		for (size_t k = 0; k < count; k++) {
+			unsigned i = grid.indices[k];
+			s.sx[k] = px[i], s.sy[k] = py[i], s.sz[k] = pz[i];
+			s.rank[i] = unsigned(k);
+		}
+		const float cut2 = cutoff * cutoff;
+		const size_t grain = 256;
+		std::vector<std::vector<unsigned>> &parts = verletParts;
+		parts.resize((count + grain - 1) / grain);
+		for (auto &part : parts) part.clear(); // keeps the capacity of earlier rebuilds
+		verletStart.assign(count + 1, 0);
+		parallelFor(threadPool, 0, count, grain, [&](size_t b, size_t e) {
+			std::vector<unsigned> &part = parts[b / grain];
+			for (size_t k = b; k < e; k++) {
+				size_t first = part.size();
+				glm::vec3 p(s.sx[k], s.sy[k], s.sz[k]);
+				v3x8 b(p.x, p.y, p.z);
+				grid.forEachNearRange(p, [&](unsigned begin, unsigned end) {
+					for (unsigned t = begin; t < end; t += 8) {
+						v3x8 d = v3x8::load(&s.sx[t], &s.sy[t], &s.sz[t]) - b;
+						f8 idx = f8(float(t)) + f8::iota();
+						unsigned hits = simd::bitmask((simd::dot(d, d) < f8(cut2)) & (idx < f8(float(end))) & (idx != f8(float(k))));
+						for (; hits; hits &= hits - 1) part.push_back(t + unsigned(std::countr_zero(hits)));
+					}
+				});
+				verletStart[k + 1] = unsigned(part.size() - first);
+			}
+		});
+		for (size_t k = 0; k < count; k++) verletStart[k + 1] += verletStart[k];
+		verletList.resize(verletStart[count]);
+		for (size_t c = 0; c < parts.size(); c++) std::copy(parts[c].begin(), parts[c].end(), verletList.begin() + verletStart[c * grain]);
+		verletX.assign(px.begin(), px.begin() + count);
+		verletY.assign(py.begin(), py.begin() + count);
+		verletZ.assign(pz.begin(), pz.begin() + count);
+		verletCutoff = cutoff;
+		verletBuilds++;
+	}
+
+	// sums for the boid at cell-order position k over its Verlet list, stored at slot: the listed entries of the sorted
+	// copies are gathered into a stack block, kBatch at a time, and run through accumulateRange, which applies the exact
+	// radii (k is not in its list, so no lane is skipped as self)
+	void accumulateVerlet(size_t k, size_t slot) {
+		constexpr unsigned kBatch = 64; // multiple of 8: the lane sums come out as over one contiguous gather
+		const unsigned begin = verletStart[k], end = verletStart[k + 1];
+		const float *self = &verletBoids[k * 8];
+		const v3x8 b(self[0], self[1], self[2]);
+		NeighborAcc acc[maxSpecies];
+		float lanes[7][kBatch]; // x, y, z, vx, vy, vz, species
+		for (unsigned j = begin; j < end; j += kBatch) {
+			unsigned n = std::min(end - j, kBatch);
+			for (unsigned l = 0; l < n; l++) {
+				const float *o = &verletBoids[size_t(verletList[j + l]) * 8];
+				lanes[0][l] = o[0], lanes[1][l] = o[1], lanes[2][l] = o[2];
+				lanes[3][l] = o[3], lanes[4][l] = o[4], lanes[5][l] = o[5];
+				lanes[6][l] = o[6];
+			}
+			for (unsigned l = n; l < ((n + 7) & ~7u); l++) // masked, but loaded
+				lanes[0][l] = lanes[1][l] = lanes[2][l] = lanes[3][l] = lanes[4][l] = lanes[5][l] = lanes[6][l] = 0.0f;
+			accumulateRange(lanes[0], lanes[1], lanes[2], lanes[3], lanes[4], lanes[5], lanes[6], 0, n, kBatch, b, acc);
+		}
+		storeSums(slot, acc);
+	}
+
+	// neighbor sums for every steered boid (list == nullptr), or for the m boids in list stored by slot
+	void gatherNeighbors(const unsigned *list = nullptr, size_t m = 0) {
+		Scratch &s = scratch;
+		const size_t active = steeredCount();
+		if (neighborSearch == NeighborSearch::Topological) {
+			kdtree.build(count, [&](size_t i) { return position(i); }, threadPool);
+			size_t k = size_t(std::clamp(topologicalK, 1, int(KDTree::maxK)));
+			if (list) {
+				parallelFor(threadPool, 0, m, 64, [&](size_t sb, size_t se) {
+					for (size_t slot = sb; slot < se; slot++) accumulateNearest(list[slot], slot, k);
+				});
+				return;
+			}
+			// walk boids in tree order so consecutive queries touch the same nodes
+			parallelFor(threadPool, 0, count, 64, [&](size_t tb, size_t te) {
+				for (size_t t = tb; t < te; t++)
+					if (kdtree.indices[t] < active) accumulateNearest(kdtree.indices[t], kdtree.indices[t], k);
+			});
+		} else if (neighborSearch == NeighborSearch::BarnesHut) {
+			octree.build(
+			    count, [&](size_t i) { return position(i); }, [&](size_t i) { return velocity(i); }, [&](size_t i) { return int(speciesId[i]); },
+			    speciesCount());
+			if (list) {
+				parallelFor(threadPool, 0, m, 64, [&](size_t sb, size_t se) {
+					for (size_t slot = sb; slot < se; slot++) accumulateOctree(list[slot], slot);
+				});
+				return;
+			}
+			// tree order keeps nearby boids on the same thread and in cache
+			parallelFor(threadPool, 0, count, 64, [&](size_t tb, size_t te) {
+				for (size_t t = tb; t < te; t++)
+					if (octree.indices[t] < active) accumulateOctree(octree.indices[t], octree.indices[t]);
+			});
+		} else if (neighborSearch == NeighborSearch::Verlet) {
+			float cutoff = std::max(neighborRadius, separationRadius) + verletSkin;
+			if (verletStale(cutoff)) buildVerlet(cutoff);
+			// reused frames only refresh the cell-order copy (the order itself is kept from the rebuild)
+			verletBoids.resize(count * 8);
+			for (size_t k = 0; k < count; k++) {
+				unsigned i = grid.indices[k];
+				float *o = &verletBoids[k * 8];
+				o[0] = px[i], o[1] = py[i], o[2] = pz[i], o[3] = vx[i], o[4] = vy[i], o[5] = vz[i], o[6] = speciesId[i], o[7] = 0.0f;
+			}
+			if (list) {
+				parallelFor(threadPool, 0, m, 256, [&](size_t sb, size_t se) {
+					for (size_t slot = sb; slot < se; slot++) accumulateVerlet(s.rank[list[slot]], slot);
+				});
+				return;
+			}
+			// walk boids in cell order so consecutive lists touch the same entries
+			parallelFor(threadPool, 0, count, 256, [&](size_t kb, size_t ke) {
+				for (size_t k = kb; k < ke; k++)
+					if (grid.indices[k] < active) accumulateVerlet(k, grid.indices[k]);
+			});
+		} else if (neighborSearch == NeighborSearch::Grid) {
+			float cell = std::max(neighborRadius, separationRadius);
+			verletStart.clear(); // the Verlet lists index the grid order
+			grid.build(count, cell, [&](size_t i) { return position(i); });
+			for (size_t k = 0; k < count; k++) {
+				unsigned i = grid.indices[k];
+				s.sx[k] = px[i], s.sy[k] = py[i], s.sz[k] = pz[i];
+				s.svx[k] = vx[i], s.svy[k] = vy[i], s.svz[k] = vz[i];
+				s.ssp[k] = speciesId[i];
+				s.rank[i] = unsigned(k);
+			}
+			if (list) {
+				parallelFor(threadPool, 0, m, 256, [&](size_t sb, size_t se) {
+					for (size_t slot = sb; slot < se; slot++) {
+						unsigned i = list[slot];
+						v3x8 b(px[i], py[i], pz[i]);
+						NeighborAcc acc[maxSpecies];
+						grid.forEachNearRange(position(i), [&](unsigned begin, unsigned end) {
+							accumulateRange(s.sx.data(), s.sy.data(), s.sz.data(), s.svx.data(), s.svy.data(), s.svz.data(), s.ssp.data(), begin,
+							                end, s.rank[i], b, acc);
+						});
+						storeSums(slot, acc);
+					}
+				});
+				return;
+			}
+			// walk boids in cell order so neighboring cells stay in cache
+			parallelFor(threadPool, 0, count, 256, [&](size_t kb, size_t ke) {
+				for (size_t k = kb; k < ke; k++) {
+					unsigned i = grid.indices[k];
+					if (i >= active) continue;
+					v3x8 b(px[i], py[i], pz[i]);
+					NeighborAcc acc[maxSpecies];
+					grid.forEachNearRange(position(i), [&](unsigned begin, unsigned end) {
+						accumulateRange(s.sx.data(), s.sy.data(), s.sz.data(), s.svx.data(), s.svy.data(), s.svz.data(), s.ssp.data(), begin, end,
+						                k, b, acc);
+					});
+					storeSums(i, acc);
+				}
+			});
+		} else {
+			size_t n = list ? m : active;
+			parallelFor(threadPool, 0, n, 32, [&](size_t sb, size_t se) {
+				for (size_t slot = sb; slot < se; slot++) {
+					size_t i = list ? list[slot] : slot;
+					NeighborAcc acc[maxSpecies];
+					accumulateRange(px.data(), py.data(), pz.data(), vx.data(), vy.data(), vz.data(), speciesId.data(), 0, count, i,
+					                v3x8(px[i], py[i], pz[i]), acc);
+					storeSums(slot, acc);
+				}
+			});
+		}
+	}
+
+	// wander draws for slots [slot, slot + 8) (n slots in total), from each boid's own stream for this frame
+	void drawWander8(size_t slot, size_t n, const unsigned *list) {
+		Scratch &s = scratch;
+		for (size_t j = slot; j < std::min(slot + 8, n); j++) {
+			size_t i = list ? list[j] : j;
+			RandomStream rs(seed, streamIds ? streamIds[i] : i, frame);
+			s.rndX[j] = rs.uniform(0, -1.0f, 1.0f);
+			s.rndY[j] = rs.uniform(1, -1.0f, 1.0f);
+			s.rndZ[j] = rs.uniform(2, -1.0f, 1.0f);
+		}
+	}
+
+	// weighted steering for slots [i, i + 8) of columns c, written to out
+	void steer8(size_t i, float dt, const PhysicsEngine *physicsEngine, const BoidColumns &c, float *outX, float *outY, float *outZ) {
+		Scratch &s = scratch;
+		const f8 zero = 0.0f;
+		const v3x8 zero3(zero, zero, zero);
+		v3x8 p = v3x8::load(c.px + i, c.py + i, c.pz + i);
+		v3x8 v = v3x8::load(c.vx + i, c.vy + i, c.vz + i);
+		f8 ms = f8::load(c.maxSpeed + i), mf = f8::load(c.maxForce + i);
+
+		// per-lane value of f(species) for the lanes' own species
+		const int species = speciesCount();
+		f8 own = species > 1 ? f8::load(c.species + i) : zero;
+		auto perLane = [&](auto f) {
+			f8 r = f(0);
+			for (int t = 1; t < species; t++) r = simd::select(own == f8(float(t)), f8(f(t)), r);
+			return r;
+		};
+
+		// separation / alignment / cohesion against each neighbor species, weighted by own weights x interaction
+		v3x8 flocking = zero3;
+		for (int t = 0; t < species; t++) {
+			size_t o = t * s.stride + i;
+			f8 n = f8::load(&s.nCount[o]), ns = f8::load(&s.sCount[o]);
+
+			// Separation
+			v3x8 separation = v3x8::load(&s.sepX[o], &s.sepY[o], &s.sepZ[o]) * (f8(1.0f) / ns);
+			separation = limitMagnitude(setMagnitude(separation, ms) - v, mf);
+			separation = simd::select(ns > zero, separation, zero3);
+
+			// Alignment
+			f8 invN = f8(1.0f) / n;
+			v3x8 alignment = v3x8::load(&s.velX[o], &s.velY[o], &s.velZ[o]) * invN;
+			alignment = limitMagnitude(setMagnitude(alignment, ms) - v, mf);
+			alignment = simd::select(n > zero, alignment, zero3);
+
+			// Cohesion
+			v3x8 desired = v3x8::load(&s.posX[o], &s.posY[o], &s.posZ[o]) * invN - p;
+			v3x8 cohesion = limitMagnitude(setMagnitude(desired, ms) - v, mf);
+			cohesion = simd::select(n > zero, cohesion, zero3);
+
+			f8 ks = perLane([&](int a) { return speciesWeights(a).wSeparation * interaction[a][t].separation; });
+			f8 ka = perLane([&](int a) { return speciesWeights(a).wAlignment * interaction[a][t].alignment; });
+			f8 kc = perLane([&](int a) { return speciesWeights(a).wCohesion * interaction[a][t].cohesion; });
+			flocking += ks * separation + ka * alignment + kc * cohesion;
+		}
+
+		// Wander: small randomized steering to break symmetry
+		v3x8 wander = v3x8::load(&s.rndX[i], &s.rndY[i], &s.rndZ[i]);
+		wander = setMagnitude(wander, ms) - v;
+		wander = limitMagnitude(wander, mf) * f8(wanderJitter * dt);
+
+		// Obstacle avoidance using physics spheres (optional); a flow field replaces the per-body loop
+		v3x8 avoid = zero3, flow = zero3;
+		if (flowField) {
+			float x[8], y[8], z[8], g[3][8], a[3][8];
+			p.store(x, y, z);
+			for (int l = 0; l < 8; l++) {
+				glm::vec3 guide, away;
+				flowField->sample(glm::vec3(x[l], y[l], z[l]), guide, away);
+				g[0][l] = guide.x, g[1][l] = guide.y, g[2][l] = guide.z;
+				a[0][l] = away.x, a[1][l] = away.y, a[2][l] = away.z;
+			}
+			v3x8 guide = v3x8::load(g[0], g[1], g[2]);
+			flow = limitMagnitude(setMagnitude(guide, ms) - v, mf);
+			flow = simd::select(simd::dot(guide, guide) > f8(1e-6f), flow, zero3);
+			v3x8 away = v3x8::load(a[0], a[1], a[2]);
+			v3x8 steerAway = limitMagnitude(setMagnitude(away, ms) - v, mf);
+			avoid = simd::select(simd::dot(away, away) > f8(1e-8f), steerAway, zero3);
+		} else if (physicsEngine) {
+			for (const auto &ob : physicsEngine->bodies) {
+				// treat static or dynamic spheres as obstacles (capsules by their closest core point)
+				f8 combined = ob.radius + boidRadius + 0.2f; // safe margin
+				v3x8 obCenter(ob.position.x, ob.position.y, ob.position.z);
+				if (ob.shape == RigidBody::CAPSULE) {
+					float len2 = glm::dot(ob.halfAxis, ob.halfAxis);
+					v3x8 h(ob.halfAxis.x, ob.halfAxis.y, ob.halfAxis.z);
+					f8 t = len2 > 0.0f ? simd::dot(p - obCenter, h) * f8(1.0f / len2) : zero;
+					obCenter += h * simd::min(simd::max(t, f8(-1.0f)), f8(1.0f));
+				}
+				v3x8 away = p - obCenter;
+				f8 d2 = simd::dot(away, away);
+				f8 hit = (d2 < combined * combined) & (d2 > f8(0.0001f));
+				if (!simd::any(hit)) continue;
+				f8 d = simd::sqrt(d2);
+				avoid += simd::select(hit, away * ((combined - d) / (combined * d)), zero3);
+			}
+			v3x8 steerAway = limitMagnitude(setMagnitude(avoid, ms) - v, mf);
+			avoid = simd::select(simd::dot(avoid, avoid) > zero, steerAway, zero3);
+		}
+
+		// Keep inside world radius: steer toward center when outside (baked into the guidance when the field confines)
+		v3x8 centerSteer = limitMagnitude(setMagnitude(zero3 - p, ms) - v, mf) * f8(centerPull);
+		centerSteer = simd::select(simd::dot(p, p) > f8(worldRadius * worldRadius), centerSteer, zero3);
+		if (flowField && flowField->worldRadius > 0.0f) centerSteer = zero3;
+
+		// Weighted sum
+		f8 kw = perLane([&](int a) { return speciesWeights(a).wWander; });
+		f8 kv = perLane([&](int a) { return speciesWeights(a).wAvoid; });
+		v3x8 total = flocking + kw * wander + kv * avoid + f8(wFlow) * flow + centerSteer;
+		total.store(outX + i, outY + i, outZ + i);
+	}
+
+	// pick the boids whose steering is recomputed this update (ascending, deterministic)
+	void selectLod(size_t budget) {
+		const size_t active = steeredCount();
+		std::vector<unsigned> &slots = scratch.slots;
+		slots.clear();
+		if (lodMode == LodMode::RoundRobin) {
+			for (size_t t = 0; t < budget; t++) slots.push_back(unsigned((lodCursor + t) % active));
+			lodCursor = (lodCursor + budget) % active;
+		} else {
+			// CameraDistance: stale boids near the camera first; ties broken by index
+			std::vector<float> &prio = scratch.outX; // free until steering runs
+			for (size_t i = 0; i < active; i++) {
+				float d = glm::length(position(i) - lodCamera);
+				prio[i] = float(lodAge[i] + 1) / (1.0f + d / lodFalloff);
+			}
+			slots.resize(active);
+			std::iota(slots.begin(), slots.end(), 0u);
+			auto higher = [&](unsigned a, unsigned b) { return prio[a] > prio[b] || (prio[a] == prio[b] && a < b); };
+			std::nth_element(slots.begin(), slots.begin() + budget, slots.end(), higher);
+			slots.resize(budget);
+		}
+		std::sort(slots.begin(), slots.end());
+	}
+
+	// instance data of boids [i, i + 8): yaw about +Y then pitch about +X, so +X stays horizontal (the basis
+	// cross(up, forward) / forward the renderer used to build per boid); straight up/down keeps yaw 0
+	void writeInstances8(size_t i) {
+		const f8 zero = 0.0f, one = 1.0f, half = 0.5f;
+		v3x8 v = v3x8::load(&vx[i], &vy[i], &vz[i]);
+		f8 len2 = simd::dot(v, v);
+		f8 moving = len2 > f8(1e-6f);
+		v3x8 f = simd::select(moving, v * (one / simd::sqrt(len2)), v3x8(zero, zero, one));
+		f8 h2 = f.x * f.x + f.z * f.z;
+		f8 flat = h2 > f8(1e-5f);
+		f8 h = simd::sqrt(h2);
+		f8 cosYaw = simd::select(flat, f.z / h, one);
+		// half angles: cos(a/2) = sqrt((1 + cos a) / 2), sin(a/2) takes the sign of sin a
+		f8 cy = simd::sqrt(simd::max((one + cosYaw) * half, zero));
+		f8 sy = simd::sqrt(simd::max((one - cosYaw) * half, zero));
+		sy = simd::select(flat & (f.x < zero), zero - sy, sy);
+		f8 cx = simd::sqrt((one + h) * half); // pitch in [-90, 90] degrees: cos(pitch) = h >= 0, sin(pitch) = -f.y
+		f8 sx = (zero - f.y) * half / cx;
+
+		float q[4][8], pos[3][8];
+		(cy * sx).store(q[0]);
+		(sy * cx).store(q[1]);
+		(zero - sy * sx).store(q[2]);
+		(cy * cx).store(q[3]);
+		v3x8::load(&px[i], &py[i], &pz[i]).store(pos[0], pos[1], pos[2]);
+		for (size_t l = 0, n = std::min<size_t>(8, count - i); l < n; l++) {
+			BoidInstance &inst = instances[i + l];
+			inst.positionScale = glm::vec4(pos[0][l], pos[1][l], pos[2][l], boidRadius);
+			inst.rotation = glm::vec4(q[0][l], q[1][l], q[2][l], q[3][l]);
+		}
+	}
+
+	// apply steering and integrate boids [i, i + 8); boids from n on keep their state
+	void integrate8(size_t i, float dt, size_t n) {
+		const v3x8 p0 = v3x8::load(&px[i], &py[i], &pz[i]);
+		const v3x8 v0 = v3x8::load(&vx[i], &vy[i], &vz[i]);
+		v3x8 p = p0, v = v0;
+		f8 ms = f8::load(&maxSpeed[i]), mf = f8::load(&maxForce[i]);
+
+		// limit acceleration (maxForce is per-boid)
+		v3x8 acc = limitMagnitude(v3x8::load(&steerX[i], &steerY[i], &steerZ[i]), mf);
+		v += acc * f8(dt);
+
+		// limit speed
+		v = limitMagnitude(v, ms);
+		p += v * f8(dt);
+
+		// simple collision with ground (y = 0)
+		p.y = simd::max(p.y, f8(0.05f));
+
+		if (i + 8 > n) {
+			f8 live = f8(float(i)) + f8::iota() < f8(float(n));
+			p = simd::select(live, p, p0), v = simd::select(live, v, v0);
+		}
+		p.store(&px[i], &py[i], &pz[i]);
+		v.store(&vx[i], &vy[i], &vz[i]);
+	}
+
+	// apply the cached steering to boids [0, n) and integrate (and pack instances of every boid while they are in cache)
+	void integrateAll(float dt, size_t n) {
+		if (writeInstances) instances.resize(count);
+		parallelFor(threadPool, 0, count, 512, [&](size_t b, size_t e) {
+			for (size_t i = b; i < e; i += 8) {
+				if (i < n) integrate8(i, dt, n);
+				if (writeInstances) writeInstances8(i);
+			}
+		});
+	}
 
   public:
-	std::vector<Boid> boids;
+	enum class NeighborSearch {
+		BruteForce,  // O(N^2) reference
+		Grid,        // uniform grid, cell = neighborRadius, 27 cells per boid
+		Topological, // topologicalK nearest boids at any distance (KD-tree), bounded cost in dense clusters
+		BarnesHut,   // octree with node aggregates for alignment/cohesion, so neighborRadius can be large
+		Verlet       // cached neighbor lists within radius + verletSkin, rebuilt only when a boid moved more than verletSkin / 2
+	};
+
+	// boid state as SoA columns, padded with simd::paddedSize(); entries [0, size()) are boids
+	std::vector<float> px, py, pz;
+	std::vector<float> vx, vy, vz;
+	std::vector<float> maxSpeed, maxForce;
+	float boidRadius = 0.08f; // visual radius
+
+	// optional worker pool for the per-boid phases; results are identical for any thread count
+	ThreadPool *threadPool = nullptr;
+
+	// optional per-boid keys of the wander streams (the boid index when null), so a boid keeps its draws when the
+	// flock is reordered or split (see SlabFlock)
+	const uint32_t *streamIds = nullptr;
+
+	// update() steers and moves only boids [0, activeCount); the rest are neighbor input only and keep their state
+	// (SlabFlock's ghosts)
+	size_t activeCount = std::numeric_limits<size_t>::max();
+
+	// when set, update() also writes instances[0, size()) for instanced rendering
+	bool writeInstances = false;
+	std::vector<BoidInstance> instances;
+
+	// level of detail: recompute steering for a budget of boids per update, the rest reuse their cached steering
+	enum class LodMode {
+		Off,
+		RoundRobin,    // consecutive windows of boids
+		CameraDistance // boids near lodCamera and boids waiting longest first
+	};
+	LodMode lodMode = LodMode::Off;
+	int lodInterval = 4;     // k: recompute 1/k of the boids per update
+	size_t lodBudget = 0;    // boids per update, overrides lodInterval when > 0 (keeps cost flat as N grows)
+	glm::vec3 lodCamera = glm::vec3(0.0f);
+	float lodFalloff = 5.0f; // CameraDistance: distance at which refresh priority halves
+
+	// optional baked guidance/avoidance (see FlowField); replaces the per-body avoidance loop, kept up to date by the owner
+	const FlowField *flowField = nullptr;
+	float wFlow = 1.0f;
 
 	// neighbor / perception
+	NeighborSearch neighborSearch = NeighborSearch::Grid;
 	float neighborRadius = 1.0f;
 	float separationRadius = 0.35f;
+	int topologicalK = 7;        // neighbors per boid in Topological mode (at most KDTree::maxK)
+	float barnesHutTheta = 0.5f; // BarnesHut opening angle (node size / distance); 0 = exact
+	float verletSkin = 0.3f;     // Verlet list margin: larger means fewer rebuilds but longer lists
+
+	// species: empty = one species using the flock-wide weights below; see addSpecies()
+	std::vector<Species> speciesParams;
+	Interaction interaction[maxSpecies][maxSpecies]; // [own species][neighbor species]; addSpecies() sets defaults
 
 	// behavior weights
 	float wSeparation = 1.6f;
@@ -57,145 +1311,452 @@ class Flock {
 	float worldRadius = 8.0f;
 	float centerPull = 1.0f; // steer toward center when far
 
-	Flock(int N = 32, unsigned int seed = 1234) : uni(-1.0f, 1.0f) {
+	Flock(int N = 32, unsigned int seed = 1234) : uni(-1.0f, 1.0f), seed(seed) {
 		rng.seed(seed);
-		boids.resize(N);
+		resize(N);
 		for (int i = 0; i < N; ++i) {
-			boids[i].position = glm::vec3((uni(rng) * worldRadius * 0.5f),
-			                              (uni(rng) * 1.0f + 1.0f), // slightly above ground
-			                              (uni(rng) * worldRadius * 0.5f));
-			boids[i].velocity = glm::normalize(glm::vec3(uni(rng), uni(rng) * 0.2f, uni(rng))) * (boids[i].maxSpeed * 0.5f);
-			boids[i].maxSpeed = 2.0f + (uni(rng) + 1.0f) * 1.0f;
-			boids[i].maxForce = 4.0f;
+			Boid b;
+			b.position = glm::vec3((uni(rng) * worldRadius * 0.5f),
+			                       (uni(rng) * 1.0f + 1.0f), // slightly above ground
+			                       (uni(rng) * worldRadius * 0.5f));
+			b.velocity = glm::normalize(glm::vec3(uni(rng), uni(rng) * 0.2f, uni(rng))) * (b.maxSpeed * 0.5f);
+			b.maxSpeed = 2.0f + (uni(rng) + 1.0f) * 1.0f;
+			b.maxForce = 4.0f;
+			setBoid(i, b);
 		}
 	}
 
-	// Update flock: dt in seconds. If physicsEngine != nullptr, boids will avoid physics bodies as obstacles.
-	void update(float dt, PhysicsEngine *physicsEngine = nullptr) {
-		if (boids.empty()) return;
+	size_t size() const { return count; }
+	int speciesOf(size_t i) const { return int(speciesId[i]); }
+	size_t speciesBegin(int s) const { return speciesStart[s]; }
+	size_t speciesEnd(int s) const { return speciesStart[s + 1]; }
 
-		// compute behaviors for each boid
-		std::vector<glm::vec3> steering(boids.size(), glm::vec3(0.0f));
+	// add a species block and return its id; the first call describes the boids already in the flock.
+	// Own species defaults to full interaction, other species to separation only.
+	int addSpecies(const Species &sp) {
+		int id = int(speciesParams.size());
+		if (id >= maxSpecies) return -1;
+		speciesParams.push_back(sp);
+		if (id > 0) speciesStart.push_back(count);
+		for (int a = 0; a <= id; a++) {
+			interaction[a][id] = a == id ? Interaction{} : Interaction{1.0f, 0.0f, 0.0f};
+			interaction[id][a] = interaction[a][id];
+		}
+		steerValid = false;
+		return id;
+	}
+	glm::vec3 position(size_t i) const { return glm::vec3(px[i], py[i], pz[i]); }
+	glm::vec3 velocity(size_t i) const { return glm::vec3(vx[i], vy[i], vz[i]); }
 
-		for (size_t i = 0; i < boids.size(); ++i) {
-			Boid &b = boids[i];
+	Boid boid(size_t i) const {
+		Boid b;
+		b.position = position(i);
+		b.velocity = velocity(i);
+		b.radius = boidRadius;
+		b.maxSpeed = maxSpeed[i];
+		b.maxForce = maxForce[i];
+		return b;
+	}
 
+	void setBoid(size_t i, const Boid &b) {
+		px[i] = b.position.x, py[i] = b.position.y, pz[i] = b.position.z;
+		vx[i] = b.velocity.x, vy[i] = b.velocity.y, vz[i] = b.velocity.z;
+		maxSpeed[i] = b.maxSpeed;
+		maxForce[i] = b.maxForce;
+	}
+
+	// resize keeping existing boids; new boids are default Boid values of the last species
+	void resize(size_t n) {
+		size_t padded = simd::paddedSize(n);
+		for (auto *c : {&px, &py, &pz, &vx, &vy, &vz, &maxSpeed, &maxForce}) c->resize(padded, 0.0f);
+		// new boids join the last species, including those growing into the old padding (which held 0)
+		speciesId.resize(padded, 0.0f);
+		for (size_t i = count; i < n; i++) speciesId[i] = float(speciesCount() - 1);
+		for (size_t i = n; i < padded; i++) speciesId[i] = 0.0f;
+		for (size_t &start : speciesStart) start = std::min(start, n);
+		speciesStart.back() = n;
+		for (auto *c : {&steerX, &steerY, &steerZ}) c->assign(padded, 0.0f);
+		lodAge.assign(padded, 0);
+		steerValid = false;
+		verletStart.clear();
+		for (size_t i = count; i < n; i++) setBoid(i, Boid());
+		for (size_t i = n; i < padded; i++) setBoid(i, Boid{glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, 0.0f, 0.0f});
+		count = n;
+		assert(speciesIdsMatchBlocks());
+	}
+
+	void addBoid(const Boid &b) {
+		resize(count + 1);
+		setBoid(count - 1, b);
+	}
+
+	// insert a boid at the end of its species block (later species shift up by one)
+	void addBoid(const Boid &b, int species) {
+		size_t at = speciesStart[species + 1];
+		resize(count + 1);
+		for (auto *c : {&px, &py, &pz, &vx, &vy, &vz, &maxSpeed, &maxForce, &speciesId})
+			std::rotate(c->begin() + at, c->begin() + count - 1, c->begin() + count);
+		for (int t = species + 1; t < speciesCount(); t++) speciesStart[t]++;
+		setBoid(at, b);
+		speciesId[at] = float(species);
+		assert(speciesIdsMatchBlocks());
+	}
+
+	// Update flock: dt in seconds. If physicsEngine != nullptr, boids will avoid physics bodies as obstacles.
+	void update(float dt, PhysicsEngine *physicsEngine = nullptr) {
+		if (count == 0) return;
+		size_t padded = simd::paddedSize(count);
+		if (scratch.stride != padded || scratch.nCount.size() != padded * speciesCount()) {
+			scratch.resize(padded, speciesCount());
+			verletStart.clear(); // rank was reset
+		}
+
+		const size_t active = steeredCount();
+		size_t budget = lodBudget > 0 ? lodBudget : (active + std::max(lodInterval, 1) - 1) / std::max(lodInterval, 1);
+		if (lodMode == LodMode::Off || !steerValid || budget >= active) {
 			// accumulate neighbors
-			glm::vec3 posSum(0.0f), velSum(0.0f);
-			glm::vec3 sepForce(0.0f);
-			int countNeighbors = 0;
-			int countSeparation = 0;
-
-			for (size_t j = 0; j < boids.size(); ++j) {
-				if (i == j) continue;
-				Boid &o = boids[j];
-				glm::vec3 diff = o.position - b.position;
-				float dist2 = glm::dot(diff, diff);
-				float neighR2 = neighborRadius * neighborRadius;
-				if (dist2 < neighR2) {
-					++countNeighbors;
-					posSum += o.position;
-					velSum += o.velocity;
+			gatherNeighbors();
+
+			// compute behaviors, 8 boids at a time (padding lanes are discarded); chunks are multiples of 8
+			BoidColumns cols = flockColumns();
+			parallelFor(threadPool, 0, active, 512, [&](size_t b, size_t e) {
+				for (size_t i = b; i < e; i += 8) {
+					drawWander8(i, active, nullptr);
+					steer8(i, dt, physicsEngine, cols, steerX.data(), steerY.data(), steerZ.data());
 				}
-				float sepR2 = separationRadius * separationRadius;
-				if (dist2 < sepR2 && dist2 > 0.00001f) {
-					// repulsive vector (away from neighbor), scaled by inverse distance
-					glm::vec3 away = b.position - o.position;
-					float invDist = 1.0f / sqrt(dist2);
-					sepForce += glm::normalize(away) * invDist;
-					++countSeparation;
+			});
+			std::fill(lodAge.begin(), lodAge.end(), 0);
+			steerValid = true;
+			evaluated = active;
+		} else {
+			// LOD: pack the selected boids, steer them 8 at a time, scatter into the steering cache
+			selectLod(budget);
+			Scratch &s = scratch;
+			const unsigned *list = s.slots.data();
+			size_t m = s.slots.size();
+			evaluated = m;
+			for (size_t slot = 0; slot < m; slot++) {
+				unsigned i = list[slot];
+				s.wpx[slot] = px[i], s.wpy[slot] = py[i], s.wpz[slot] = pz[i];
+				s.wvx[slot] = vx[i], s.wvy[slot] = vy[i], s.wvz[slot] = vz[i];
+				s.wms[slot] = maxSpeed[i], s.wmf[slot] = maxForce[i], s.wsp[slot] = speciesId[i];
+			}
+			gatherNeighbors(list, m);
+			BoidColumns cols = packedColumns();
+			parallelFor(threadPool, 0, m, 512, [&](size_t b, size_t e) {
+				for (size_t i = b; i < e; i += 8) {
+					drawWander8(i, m, list);
+					steer8(i, dt, physicsEngine, cols, s.outX.data(), s.outY.data(), s.outZ.data());
 				}
+			});
+			for (size_t i = 0; i < count; i++) lodAge[i]++;
+			for (size_t slot = 0; slot < m; slot++) {
+				unsigned i = list[slot];
+				steerX[i] = s.outX[slot], steerY[i] = s.outY[slot], steerZ[i] = s.outZ[slot];
+				lodAge[i] = 0;
 			}
+		}
 
-			// Separation
-			glm::vec3 separation(0.0f);
-			if (countSeparation > 0) {
-				separation = sepForce / float(countSeparation);
-				separation = setMagnitude(separation, b.maxSpeed);
-				separation -= b.velocity;
-				separation = limitMagnitude(separation, b.maxForce);
-			}
+		integrateAll(dt, active);
+		frame++;
+	}
 
-			// Alignment
-			glm::vec3 alignment(0.0f);
-			if (countNeighbors > 0) {
-				glm::vec3 avgV = velSum / float(countNeighbors);
-				avgV = setMagnitude(avgV, b.maxSpeed);
-				alignment = avgV - b.velocity;
-				alignment = limitMagnitude(alignment, b.maxForce);
-			}
+	// fill instances from the current state without stepping (e.g. before the first update)
+	void updateInstances() {
+		instances.resize(count);
+		parallelFor(threadPool, 0, count, 512, [&](size_t b, size_t e) {
+			for (size_t i = b; i < e; i += 8) writeInstances8(i);
+		});
+	}
 
-			// Cohesion
-			glm::vec3 cohesion(0.0f);
-			if (countNeighbors > 0) {
-				glm::vec3 center = posSum / float(countNeighbors);
-				glm::vec3 desired = center - b.position;
-				desired = setMagnitude(desired, b.maxSpeed);
-				cohesion = desired - b.velocity;
-				cohesion = limitMagnitude(cohesion, b.maxForce);
-			}
-
-			// Wander: small randomized steering to break symmetry
-			glm::vec3 wander = glm::vec3(uni(rng), uni(rng), uni(rng));
-			wander = glm::normalize(wander) * wanderRadius;
-			wander = setMagnitude(wander, b.maxSpeed) - b.velocity;
-			wander = limitMagnitude(wander, b.maxForce) * (wanderJitter * dt);
-
-			// Obstacle avoidance using physics spheres (optional)
-			glm::vec3 avoid(0.0f);
-			if (physicsEngine) {
-				for (const auto &ob : physicsEngine->bodies) {
-					// treat static or dynamic spheres as obstacles
-					float combined = ob.radius + b.radius + 0.2f; // safe margin
-					glm::vec3 diff = ob.position - b.position;
-					float d2 = glm::dot(diff, diff);
-					if (d2 < combined * combined && d2 > 0.0001f) {
-						float d = sqrt(d2);
-						glm::vec3 away = b.position - ob.position;
-						avoid += glm::normalize(away) * ((combined - d) / combined);
-					}
-				}
-				if (glm::dot(avoid, avoid) > 0.0f) {
-					avoid = setMagnitude(avoid, b.maxSpeed);
-					avoid -= b.velocity;
-					avoid = limitMagnitude(avoid, b.maxForce);
-				}
-			}
+	// mean alignment/cohesion neighbors of the boids evaluated in the last update
+	double averageNeighbors() const {
+		double sum = 0.0;
+		for (int t = 0; t < speciesCount(); t++)
+			for (size_t i = 0; i < evaluated; i++) sum += scratch.nCount[t * scratch.stride + i];
+		return evaluated ? sum / double(evaluated) : 0.0;
+	}
+
+	// number of Verlet list rebuilds so far (Verlet mode)
+	size_t verletRebuilds() const { return verletBuilds; }
+
+	// bytes reserved by the boid columns, steering cache, scratch and search structures
+	size_t memoryBytes() const {
+		size_t bytes = 0;
+		auto add = [&](const auto &v) { bytes += v.capacity() * sizeof(v[0]); };
+		for (auto *c : {&px, &py, &pz, &vx, &vy, &vz, &maxSpeed, &maxForce, &speciesId, &steerX, &steerY, &steerZ}) add(*c);
+		add(lodAge), add(instances);
+		add(verletStart), add(verletList), add(verletX), add(verletY), add(verletZ), add(verletBoids);
+		for (const auto &part : verletParts) add(part);
+		const Scratch &s = scratch;
+		for (auto *c : {&s.sx, &s.sy, &s.sz, &s.svx, &s.svy, &s.svz, &s.ssp, &s.posX, &s.posY, &s.posZ, &s.velX, &s.velY, &s.velZ, &s.sepX,
+		                &s.sepY, &s.sepZ, &s.nCount, &s.sCount, &s.rndX, &s.rndY, &s.rndZ, &s.wpx, &s.wpy, &s.wpz, &s.wvx, &s.wvy, &s.wvz,
+		                &s.wms, &s.wmf, &s.wsp, &s.outX, &s.outY, &s.outZ})
+			add(*c);
+		add(s.rank), add(s.slots);
+		return bytes + grid.memoryBytes() + kdtree.memoryBytes() + octree.memoryBytes();
+	}
+
+	// feed velocities (and optionally perception radii and the occupied cells of the last neighbor grid) to a debug batcher
+	void debugDraw(DebugDraw &dd, bool neighborRadii = false, bool cells = false) const {
+		for (size_t i = 0; i < count; i++) {
+			dd.arrow(position(i), velocity(i) * 0.2f, glm::vec4(0.3f, 1.0f, 0.3f, 1.0f));
+			if (neighborRadii) dd.circle(position(i), neighborRadius, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec4(0.3f, 1.0f, 0.3f, 0.25f), 12);
+		}
+		if (cells) grid.debugDraw(dd, glm::vec4(0.3f, 1.0f, 0.3f, 0.3f));
+	}
+};
+// ============================================================================
+// Compile-time composed flocking: ComposedFlock<Separation, Alignment, Cohesion> runs only the listed behaviors,
+// fused into one neighbor loop per boid. A behavior is a struct with
+//   Acc                                   per-boid neighbor accumulator (empty for behaviors without neighbors)
+//   usesNeighbors, radius(flock)          whether it needs the neighbor loop and how far it looks
+//   accumulate(acc, neighbors, flock)     one block of 8 candidates (NeighborLanes)
+//   steer(acc, boid, ctx)                 its weighted steering for one boid
+// Behaviors that are not listed cost nothing: no accumulator, no lane math, and no grid at all when none needs
+// neighbors. New behaviors derive from NoNeighbors or follow Separation.
+// ============================================================================
+
+namespace behaviors {
+using simd::f8;
+using simd::v3x8;
+
+// 8 candidate neighbors of one boid; invalid lanes (padding, the boid itself) have valid cleared
+struct NeighborLanes {
+	v3x8 self, position, velocity, offset; // offset = position - self
+	f8 dist2, valid;
+};
+
+// the boid being steered
+struct BoidState {
+	glm::vec3 position, velocity;
+	float maxSpeed, maxForce;
+};
 
-			// Keep inside world radius: steer toward center when outside
-			glm::vec3 centerSteer(0.0f);
-			float distCenter2 = glm::dot(b.position, b.position);
-			if (distCenter2 > (worldRadius * worldRadius)) {
-				glm::vec3 toCenter = -b.position;
-				toCenter = setMagnitude(toCenter, b.maxSpeed);
-				centerSteer = toCenter - b.velocity;
-				centerSteer = limitMagnitude(centerSteer, b.maxForce) * centerPull;
+// per-update inputs of the non-neighbor behaviors
+struct StepContext {
+	const Flock &flock;
+	float dt;
+	const PhysicsEngine *physics;
+	RandomStream wander; // this boid's stream for this update
+};
+
+inline glm::vec3 limitMagnitude(const glm::vec3 &v, float maxMag) {
+	float len2 = glm::dot(v, v);
+	return len2 > maxMag * maxMag ? glm::normalize(v) * maxMag : v;
+}
+inline glm::vec3 setMagnitude(const glm::vec3 &v, float mag) {
+	float l = glm::length(v);
+	return l < 1e-6f ? glm::vec3(0.0f) : v * (mag / l);
+}
+// steer from the current velocity toward desired at full speed, limited to the boid's force
+inline glm::vec3 steerToward(const glm::vec3 &desired, const BoidState &b) {
+	return limitMagnitude(setMagnitude(desired, b.maxSpeed) - b.velocity, b.maxForce);
+}
+inline glm::vec3 hsum3(const v3x8 &v) { return glm::vec3(simd::hsum(v.x), simd::hsum(v.y), simd::hsum(v.z)); }
+
+// base of the behaviors that do not look at neighbors
+struct NoNeighbors {
+	struct Acc {};
+	static constexpr bool usesNeighbors = false;
+	static float radius(const Flock &) { return 0.0f; }
+	static void accumulate(Acc &, const NeighborLanes &, const Flock &) {}
+};
+
+struct Separation {
+	struct Acc {
+		v3x8 away{0.0f, 0.0f, 0.0f};
+		f8 n = 0.0f;
+	};
+	static constexpr bool usesNeighbors = true;
+	static float radius(const Flock &f) { return f.separationRadius; }
+	static void accumulate(Acc &a, const NeighborLanes &nb, const Flock &f) {
+		f8 in = nb.valid & (nb.dist2 < f8(f.separationRadius * f.separationRadius)) & (nb.dist2 > f8(0.00001f));
+		// away from the neighbor, scaled by inverse distance: normalize(away) / d = away / d^2
+		a.away += simd::select(in, (nb.self - nb.position) * (f8(1.0f) / nb.dist2), v3x8(0.0f, 0.0f, 0.0f));
+		a.n += simd::select(in, f8(1.0f), f8(0.0f));
+	}
+	static glm::vec3 steer(const Acc &a, const BoidState &b, const StepContext &ctx) {
+		float n = simd::hsum(a.n);
+		return n > 0.0f ? ctx.flock.wSeparation * steerToward(hsum3(a.away) / n, b) : glm::vec3(0.0f);
+	}
+};
+
+struct Alignment {
+	struct Acc {
+		v3x8 vel{0.0f, 0.0f, 0.0f};
+		f8 n = 0.0f;
+	};
+	static constexpr bool usesNeighbors = true;
+	static float radius(const Flock &f) { return f.neighborRadius; }
+	static void accumulate(Acc &a, const NeighborLanes &nb, const Flock &f) {
+		f8 in = nb.valid & (nb.dist2 < f8(f.neighborRadius * f.neighborRadius));
+		a.vel += simd::select(in, nb.velocity, v3x8(0.0f, 0.0f, 0.0f));
+		a.n += simd::select(in, f8(1.0f), f8(0.0f));
+	}
+	static glm::vec3 steer(const Acc &a, const BoidState &b, const StepContext &ctx) {
+		float n = simd::hsum(a.n);
+		return n > 0.0f ? ctx.flock.wAlignment * steerToward(hsum3(a.vel) / n, b) : glm::vec3(0.0f);
+	}
+};
+
+struct Cohesion {
+	struct Acc {
+		v3x8 offset{0.0f, 0.0f, 0.0f}; // relative to the boid, so large coordinates keep their precision
+		f8 n = 0.0f;
+	};
+	static constexpr bool usesNeighbors = true;
+	static float radius(const Flock &f) { return f.neighborRadius; }
+	static void accumulate(Acc &a, const NeighborLanes &nb, const Flock &f) {
+		f8 in = nb.valid & (nb.dist2 < f8(f.neighborRadius * f.neighborRadius));
+		a.offset += simd::select(in, nb.offset, v3x8(0.0f, 0.0f, 0.0f));
+		a.n += simd::select(in, f8(1.0f), f8(0.0f));
+	}
+	static glm::vec3 steer(const Acc &a, const BoidState &b, const StepContext &ctx) {
+		float n = simd::hsum(a.n);
+		return n > 0.0f ? ctx.flock.wCohesion * steerToward(hsum3(a.offset) / n, b) : glm::vec3(0.0f);
+	}
+};
+
+// small randomized steering to break symmetry
+struct Wander : NoNeighbors {
+	static glm::vec3 steer(const Acc &, const BoidState &b, const StepContext &ctx) {
+		const RandomStream &rs = ctx.wander;
+		glm::vec3 r(rs.uniform(0, -1.0f, 1.0f), rs.uniform(1, -1.0f, 1.0f), rs.uniform(2, -1.0f, 1.0f));
+		const Flock &f = ctx.flock;
+		return f.wWander * f.wanderJitter * ctx.dt * steerToward(r, b);
+	}
+};
+
+// away from physics bodies (capsules by their closest core point), or from the flow field's blocked nodes when set
+struct Avoid : NoNeighbors {
+	static glm::vec3 steer(const Acc &, const BoidState &b, const StepContext &ctx) {
+		const Flock &f = ctx.flock;
+		glm::vec3 away(0.0f);
+		if (f.flowField) {
+			glm::vec3 guide;
+			f.flowField->sample(b.position, guide, away);
+			return glm::dot(away, away) > 1e-8f ? f.wAvoid * steerToward(away, b) : glm::vec3(0.0f);
+		}
+		if (!ctx.physics) return glm::vec3(0.0f);
+		for (const auto &ob : ctx.physics->bodies) {
+			float combined = ob.radius + f.boidRadius + 0.2f; // safe margin
+			glm::vec3 center = ob.position;
+			if (ob.shape == RigidBody::CAPSULE) {
+				float len2 = glm::dot(ob.halfAxis, ob.halfAxis);
+				if (len2 > 0.0f) center += ob.halfAxis * glm::clamp(glm::dot(b.position - center, ob.halfAxis) / len2, -1.0f, 1.0f);
+			}
+			glm::vec3 d = b.position - center;
+			float d2 = glm::dot(d, d);
+			if (d2 < combined * combined && d2 > 0.0001f) {
+				float len = std::sqrt(d2);
+				away += d * ((combined - len) / (combined * len));
 			}
+		}
+		return glm::dot(away, away) > 0.0f ? f.wAvoid * steerToward(away, b) : glm::vec3(0.0f);
+	}
+};
 
-			// Weighted sum
-			glm::vec3 total =
-			    wSeparation * separation + wAlignment * alignment + wCohesion * cohesion + wWander * wander + wAvoid * avoid + centerSteer;
-			steering[i] = total;
+// along the flow field's baked guidance (nothing without Flock::flowField)
+struct Flow : NoNeighbors {
+	static glm::vec3 steer(const Acc &, const BoidState &b, const StepContext &ctx) {
+		const Flock &f = ctx.flock;
+		if (!f.flowField) return glm::vec3(0.0f);
+		glm::vec3 guide, away;
+		f.flowField->sample(b.position, guide, away);
+		return glm::dot(guide, guide) > 1e-6f ? f.wFlow * steerToward(guide, b) : glm::vec3(0.0f);
+	}
+};
+
+// back toward the origin outside worldRadius (left to the flow field when it confines)
+struct CenterPull : NoNeighbors {
+	static glm::vec3 steer(const Acc &, const BoidState &b, const StepContext &ctx) {
+		const Flock &f = ctx.flock;
+		if (f.flowField && f.flowField->worldRadius > 0.0f) return glm::vec3(0.0f);
+		if (glm::dot(b.position, b.position) <= f.worldRadius * f.worldRadius) return glm::vec3(0.0f);
+		return f.centerPull * steerToward(-b.position, b);
+	}
+};
+} // namespace behaviors
+
+// Flock whose update() runs only Behaviors, fused into one neighbor loop per boid over a uniform grid sized to the
+// largest behavior radius. Storage, integration and instancing are Flock's; neighborSearch, LOD and species are not
+// used (one species with the flock-wide weights), so Flock is a protected base and only the parts that apply are
+// public here. A ComposedFlock is not a Flock: Flock::update would run the full pipeline instead.
+template <typename... Behaviors> class ComposedFlock : protected Flock {
+	static constexpr bool usesNeighbors = (false || ... || Behaviors::usesNeighbors);
+
+	// steering of boid i (at position self of the cell order) from all behaviors
+	void steerBoid(size_t i, size_t self, float dt, const PhysicsEngine *physicsEngine) {
+		behaviors::BoidState boid{position(i), velocity(i), maxSpeed[i], maxForce[i]};
+		std::tuple<typename Behaviors::Acc...> acc;
+		if constexpr (usesNeighbors) {
+			const Scratch &s = scratch;
+			behaviors::NeighborLanes nb;
+			nb.self = v3x8(boid.position.x, boid.position.y, boid.position.z);
+			const f8 fself = float(self);
+			grid.forEachNearRange(boid.position, [&](unsigned begin, unsigned end) {
+				const f8 fend = float(end);
+				for (size_t k = begin; k < end; k += 8) {
+					f8 idx = f8(float(k)) + f8::iota();
+					nb.valid = (idx < fend) & (idx != fself);
+					nb.position = v3x8::load(&s.sx[k], &s.sy[k], &s.sz[k]);
+					nb.velocity = v3x8::load(&s.svx[k], &s.svy[k], &s.svz[k]);
+					nb.offset = nb.position - nb.self;
+					nb.dist2 = simd::dot(nb.offset, nb.offset);
+					std::apply([&](auto &...a) { (Behaviors::accumulate(a, nb, *this), ...); }, acc);
+				}
+			});
 		}
+		behaviors::StepContext ctx{*this, dt, physicsEngine, RandomStream(seed, streamIds ? streamIds[i] : i, frame)};
+		glm::vec3 total(0.0f);
+		std::apply([&](const auto &...a) { ((total += Behaviors::steer(a, boid, ctx)), ...); }, acc);
+		steerX[i] = total.x, steerY[i] = total.y, steerZ[i] = total.z;
+	}
 
-		// Apply steering and integrate
-		for (size_t i = 0; i < boids.size(); ++i) {
-			Boid &b = boids[i];
-			glm::vec3 acc = steering[i];
-			// limit acceleration (maxForce is per-boid)
-			if (glm::dot(acc, acc) > 0.0f) acc = limitMagnitude(acc, b.maxForce);
-			b.velocity += acc * dt;
+  public:
+	using Flock::Flock;
 
-			// limit speed
-			b.velocity = limitMagnitude(b.velocity, b.maxSpeed);
-			b.position += b.velocity * dt;
+	// boid state, worker pool, wander stream keys and instancing
+	using Flock::boidRadius, Flock::maxForce, Flock::maxSpeed, Flock::px, Flock::py, Flock::pz, Flock::vx, Flock::vy, Flock::vz;
+	using Flock::instances, Flock::streamIds, Flock::threadPool, Flock::writeInstances;
+	// flock-wide radii and weights read by the behaviors
+	using Flock::centerPull, Flock::flowField, Flock::neighborRadius, Flock::separationRadius, Flock::worldRadius;
+	using Flock::wAlignment, Flock::wanderJitter, Flock::wAvoid, Flock::wCohesion, Flock::wFlow, Flock::wSeparation, Flock::wWander;
 
-			// simple collision with ground (y = 0)
-			if (b.position.y < 0.05f) b.position.y = 0.05f;
+	using Flock::boid, Flock::position, Flock::setBoid, Flock::velocity;
+	using Flock::debugDraw, Flock::memoryBytes, Flock::resize, Flock::size, Flock::updateInstances;
 
-			// reset acceleration for next frame
-			b.acceleration = glm::vec3(0.0f);
+	void addBoid(const Boid &b) { Flock::addBoid(b); } // one species: the per-species overload does not apply
+
+	void update(float dt, PhysicsEngine *physicsEngine = nullptr) {
+		if (count == 0) return;
+		size_t padded = simd::paddedSize(count);
+		if (scratch.stride != padded || scratch.nCount.size() != padded * speciesCount()) scratch.resize(padded, speciesCount());
+
+		if constexpr (usesNeighbors) {
+			float cell = std::max({Behaviors::radius(*this)...});
+			grid.build(count, cell, [&](size_t i) { return position(i); });
+			Scratch &s = scratch;
+			for (size_t k = 0; k < count; k++) {
+				unsigned i = grid.indices[k];
+				s.sx[k] = px[i], s.sy[k] = py[i], s.sz[k] = pz[i];
+				s.svx[k] = vx[i], s.svy[k] = vy[i], s.svz[k] = vz[i];
+			}
+			verletStart.clear(); // the grid was rebuilt with another cell
+			// cell order keeps neighboring cells in cache
+			parallelFor(threadPool, 0, count, 256, [&](size_t kb, size_t ke) {
+				for (size_t k = kb; k < ke; k++) steerBoid(grid.indices[k], k, dt, physicsEngine);
+			});
+		} else {
+			parallelFor(threadPool, 0, count, 256, [&](size_t b, size_t e) {
+				for (size_t i = b; i < e; i++) steerBoid(i, 0, dt, physicsEngine);
+			});
 		}
+		steerValid = false; // Flock::update's LOD cache does not hold these
+		evaluated = 0;
+		integrateAll(dt, count);
+		frame++;
 	}
 };
 } // namespace oglprojs
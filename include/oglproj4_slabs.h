@@ -0,0 +1,363 @@
+#ifndef OGLPROJ4_SLABS_H
+#define OGLPROJ4_SLABS_H
+
+#include "oglproj4.h"
+#include "oglprojs_shm.h"
+
+#if defined(__linux__)
+
+#include <chrono>
+#include <thread>
+
+#include <dirent.h>
+#include <sys/wait.h>
+
+namespace oglprojs {
+
+// ============================================================================
+// SlabFlock: a Flock split along x into slabs, each stepped by its own forked process so the slabs do not share
+// memory bandwidth. Every step each slab sends its neighbors one message through a shared-memory ring: the boids that
+// left the slab in the previous step (migrants) and the boids within the perception radius of the shared face (ghosts).
+// Ghosts take part in the neighbor sums of the receiving slab (Flock::activeCount keeps them out of steering and
+// integration) and are dropped after its update.
+//
+// The result is deterministic for a given slab count: slabs assemble their boids in a fixed order, wander streams are
+// keyed by boid id (Flock::streamIds), and read() merges by id. One slab reproduces Flock::update exactly.
+// Neighbor sums are exact for the radius searches (Grid, Verlet, BruteForce) while every slab is at least the
+// perception radius wide and no boid crosses a whole slab in one step; Topological and BarnesHut only see the halo.
+// ============================================================================
+
+class SlabFlock {
+  public:
+	static constexpr int maxSlabs = 64;
+
+	// one boid in flight or in the merged output
+	struct Record {
+		float px, py, pz, vx, vy, vz, maxSpeed, maxForce;
+		uint32_t id, pad;
+	};
+
+	size_t ringBytes = size_t(1) << 20; // per direction and slab face; any message size streams through
+	unsigned threadsPerSlab = 1;        // ThreadPool size inside each slab process
+
+	SlabFlock() = default;
+	SlabFlock(const SlabFlock &) = delete;
+	SlabFlock &operator=(const SlabFlock &) = delete;
+	~SlabFlock() { stop(); }
+
+	// fork one process per slab on a copy of flock (boid ids are its indices) and of the physics obstacles as they are now.
+	// Slab faces sit at quantiles of the current x, so the slabs start with equal boid counts.
+	// Precondition: the calling process has a single thread. The children allocate and start their own pools, which
+	// POSIX only allows after fork() in a single-threaded parent, so call start() before creating any ThreadPool (or
+	// after destroying it); it fails otherwise. The parent may create threads once start() returned.
+	bool start(const Flock &flock, int slabs, PhysicsEngine *physics = nullptr) {
+		stop();
+		if (slabs < 1 || slabs > maxSlabs || flock.size() == 0) return false;
+		if (threadCount() != 1) {
+			std::cerr << "SlabFlock: start() needs a single-threaded process (create thread pools after it)" << std::endl;
+			return false;
+		}
+		if (!flock.speciesParams.empty()) {
+			std::cerr << "SlabFlock: species are not supported" << std::endl;
+			return false;
+		}
+		numSlabs = slabs;
+		count = flock.size();
+
+		std::vector<float> xs(flock.px.begin(), flock.px.begin() + count);
+		std::sort(xs.begin(), xs.end());
+		faces.assign(slabs + 1, 0.0f);
+		faces[0] = -std::numeric_limits<float>::infinity();
+		faces[slabs] = std::numeric_limits<float>::infinity();
+		for (int s = 1; s < slabs; s++) faces[s] = xs[count * s / slabs];
+		for (int s = 1; s + 1 < slabs; s++)
+			if (faces[s + 1] - faces[s] < halo(flock))
+				std::cerr << "SlabFlock: slab " << s << " is narrower than the perception radius, neighbor sums will be partial" << std::endl;
+
+		// layout: control block | merged output | one ring per slab and direction
+		size_t ringStride = ShmRing::bytesFor(ringBytes);
+		size_t outputAt = (sizeof(Control) + 63) & ~size_t(63);
+		size_t ringsAt = (outputAt + count * sizeof(Record) + 63) & ~size_t(63);
+		if (!shm.map(ringsAt + 2 * slabs * ringStride)) {
+			std::cerr << "SlabFlock: failed to map shared memory" << std::endl;
+			return false;
+		}
+		unsigned char *base = static_cast<unsigned char *>(shm.data());
+		control = new (base) Control;
+		output = reinterpret_cast<Record *>(base + outputAt);
+		for (int s = 0; s < slabs; s++)
+			for (int d = 0; d < 2; d++) rings[s][d] = ShmRing::create(base + ringsAt + (2 * s + d) * ringStride, ringBytes);
+		for (size_t i = 0; i < count; i++) output[i] = record(flock, i, uint32_t(i));
+
+		for (int s = 0; s < slabs; s++) {
+			pid_t pid = fork();
+			if (pid < 0) {
+				std::cerr << "SlabFlock: fork failed" << std::endl;
+				stop();
+				return false;
+			}
+			if (pid == 0) {
+				runSlab(s, flock, physics);
+				_exit(0); // skip the parent's atexit handlers and destructors (GL context, pools)
+			}
+			workers.push_back(pid);
+		}
+		return true;
+	}
+
+	// advance every slab n steps of dt; returns when all slabs have written their boids to the merged output
+	bool step(int n, float dt) {
+		if (workers.empty() || n <= 0) return !workers.empty();
+		control->dt = dt;
+		uint64_t target = control->target.load() + uint64_t(n);
+		control->target.store(target, std::memory_order_release);
+		for (int s = 0; s < numSlabs; s++) {
+			for (unsigned spin = 0; control->reached[s].load(std::memory_order_acquire) < target; spin++) {
+				if (spin % 1024 == 1023 && anyWorkerExited()) {
+					std::cerr << "SlabFlock: a slab process exited" << std::endl;
+					stop();
+					return false;
+				}
+				backoff(spin);
+			}
+		}
+		return true;
+	}
+
+	// copy the merged boids back into flock (same size as the flock passed to start)
+	void read(Flock &flock) const {
+		if (!output || flock.size() != count) return;
+		for (size_t i = 0; i < count; i++) {
+			const Record &r = output[i];
+			flock.setBoid(i, Boid{glm::vec3(r.px, r.py, r.pz), glm::vec3(r.vx, r.vy, r.vz), flock.boidRadius, r.maxSpeed, r.maxForce});
+		}
+	}
+
+	int slabs() const { return numSlabs; }
+	// boids owned by slab s after the last step()
+	size_t slabSize(int s) const { return control ? control->owned[s].load(std::memory_order_acquire) : 0; }
+
+	void stop() {
+		if (control) control->quit.store(1, std::memory_order_release);
+		for (pid_t pid : workers) waitpid(pid, nullptr, 0);
+		workers.clear();
+		shm.unmap();
+		control = nullptr;
+		output = nullptr;
+		numSlabs = 0;
+	}
+
+  private:
+	struct Control {
+		std::atomic<uint64_t> target{0};              // steps requested by the parent
+		std::atomic<int> quit{0};                     // set by stop()
+		float dt = 0.0f;                              // written before target is raised
+		std::atomic<uint64_t> reached[maxSlabs] = {}; // steps done, raised after the slab wrote its output
+		std::atomic<uint32_t> owned[maxSlabs] = {};   // boids each slab wrote at its last output
+	};
+	// message header; migrants then ghosts follow as Records
+	struct Header {
+		uint32_t migrants, ghosts;
+	};
+
+	SharedMemory shm;
+	Control *control = nullptr;
+	Record *output = nullptr;         // merged boids, indexed by id
+	ShmRing *rings[maxSlabs][2] = {}; // [slab][0] toward slab - 1, [slab][1] toward slab + 1
+	std::vector<pid_t> workers;       // slab processes
+	std::vector<float> faces;         // slab s owns x in [faces[s], faces[s + 1])
+	int numSlabs = 0;
+	size_t count = 0;
+
+	static float halo(const Flock &f) { return std::max(f.neighborRadius, f.separationRadius); }
+
+	// threads of this process (entries of /proc/self/task), 0 when unknown
+	static size_t threadCount() {
+		DIR *dir = opendir("/proc/self/task");
+		if (!dir) return 0;
+		size_t n = 0;
+		while (const dirent *e = readdir(dir))
+			if (e->d_name[0] != '.') n++;
+		closedir(dir);
+		return n;
+	}
+
+	static Record record(const Flock &f, size_t i, uint32_t id) {
+		return {f.px[i], f.py[i], f.pz[i], f.vx[i], f.vy[i], f.vz[i], f.maxSpeed[i], f.maxForce[i], id, 0};
+	}
+
+	static void backoff(unsigned spin) {
+		if (spin < 256) return;
+		if (spin < 4096) std::this_thread::yield();
+		else std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+
+	bool anyWorkerExited() const {
+		for (pid_t pid : workers)
+			if (waitpid(pid, nullptr, WNOHANG) != 0) return true;
+		return false;
+	}
+
+	// outgoing message to one neighbor, streamed until sent
+	struct Outgoing {
+		ShmRing *ring = nullptr;
+		std::vector<unsigned char> bytes;
+		size_t sent = 0;
+	};
+	// incoming message from one neighbor: the header first, then its records
+	struct Incoming {
+		ShmRing *ring = nullptr;
+		std::vector<unsigned char> bytes;
+		size_t got = 0;
+		bool sized = false;
+		const Header &header() const { return *reinterpret_cast<const Header *>(bytes.data()); }
+		const Record *records() const { return reinterpret_cast<const Record *>(bytes.data() + sizeof(Header)); }
+	};
+
+	static void pack(Outgoing &out, const std::vector<Record> &migrants, const std::vector<Record> &ghosts) {
+		Header h{uint32_t(migrants.size()), uint32_t(ghosts.size())};
+		out.bytes.resize(sizeof(Header) + (migrants.size() + ghosts.size()) * sizeof(Record));
+		out.sent = 0;
+		std::memcpy(out.bytes.data(), &h, sizeof(Header));
+		if (!migrants.empty()) std::memcpy(out.bytes.data() + sizeof(Header), migrants.data(), migrants.size() * sizeof(Record));
+		if (!ghosts.empty())
+			std::memcpy(out.bytes.data() + sizeof(Header) + migrants.size() * sizeof(Record), ghosts.data(), ghosts.size() * sizeof(Record));
+	}
+
+	// alternate partial writes and reads until both directions are through; false when asked to quit meanwhile
+	bool exchange(Outgoing *out, int numOut, Incoming *in, int numIn) {
+		for (int k = 0; k < numIn; k++) {
+			in[k].bytes.resize(sizeof(Header));
+			in[k].got = 0;
+			in[k].sized = false;
+		}
+		for (unsigned spin = 0;; spin++) {
+			bool busy = false, moved = false;
+			for (int k = 0; k < numOut; k++) {
+				Outgoing &o = out[k];
+				if (o.sent == o.bytes.size()) continue;
+				size_t n = o.ring->writeSome(o.bytes.data() + o.sent, o.bytes.size() - o.sent);
+				o.sent += n, moved |= n > 0, busy |= o.sent < o.bytes.size();
+			}
+			for (int k = 0; k < numIn; k++) {
+				Incoming &i = in[k];
+				if (i.sized && i.got == i.bytes.size()) continue;
+				size_t n = i.ring->readSome(i.bytes.data() + i.got, i.bytes.size() - i.got);
+				i.got += n, moved |= n > 0;
+				if (!i.sized && i.got == sizeof(Header)) {
+					i.sized = true;
+					i.bytes.resize(sizeof(Header) + (size_t(i.header().migrants) + i.header().ghosts) * sizeof(Record));
+				}
+				busy |= !i.sized || i.got < i.bytes.size();
+			}
+			if (!busy) return true;
+			if (moved) spin = 0;
+			if (spin % 1024 == 1023 && control->quit.load(std::memory_order_acquire)) return false;
+			backoff(spin);
+		}
+	}
+
+	// body of the process owning slab s (runs in the forked child)
+	void runSlab(int s, const Flock &flock, PhysicsEngine *physics) {
+		const float lo = faces[s], hi = faces[s + 1], h = halo(flock);
+		std::unique_ptr<ThreadPool> pool;
+		if (threadsPerSlab > 1) pool = std::make_unique<ThreadPool>(threadsPerSlab);
+
+		Flock local = flock;
+		local.threadPool = pool.get();
+		local.writeInstances = false;
+
+		std::vector<Record> owned, ghosts, migrants[2], faceGhosts[2];
+		for (size_t i = 0; i < count; i++)
+			if (flock.px[i] >= lo && flock.px[i] < hi) owned.push_back(record(flock, i, uint32_t(i)));
+
+		// neighbors: d = 0 is slab s - 1, d = 1 is slab s + 1
+		bool has[2] = {s > 0, s + 1 < numSlabs};
+		Outgoing out[2];
+		Incoming in[2];
+		int numOut = 0, numIn = 0;
+		for (int d = 0; d < 2; d++)
+			if (has[d]) {
+				out[numOut++].ring = rings[s][d];
+				in[numIn++].ring = rings[d == 0 ? s - 1 : s + 1][1 - d];
+			}
+
+		std::vector<uint32_t> ids;
+		uint64_t done = 0;
+		for (unsigned spin = 0;; spin++) {
+			if (control->quit.load(std::memory_order_acquire)) return;
+			uint64_t target = control->target.load(std::memory_order_acquire);
+			if (done >= target) {
+				backoff(spin);
+				continue;
+			}
+			spin = 0;
+			float dt = control->dt;
+
+			// ghosts for each neighbor: owned boids within the halo of the shared face
+			for (int d = 0; d < 2; d++) faceGhosts[d].clear();
+			for (const Record &r : owned) {
+				if (has[0] && r.px < lo + h) faceGhosts[0].push_back(r);
+				if (has[1] && r.px >= hi - h) faceGhosts[1].push_back(r);
+			}
+			for (int d = 0, k = 0; d < 2; d++)
+				if (has[d]) pack(out[k++], migrants[d], faceGhosts[d]);
+			if (!exchange(out, numOut, in, numIn)) return;
+
+			// local order: owned, migrants from below then above, ghosts from below then above, then own migrants
+			// still within the halo (they left this slab at the end of the last step and are the neighbor's now)
+			ghosts.clear();
+			for (int k = 0; k < numIn; k++) {
+				const Header &hd = in[k].header();
+				const Record *r = in[k].records();
+				owned.insert(owned.end(), r, r + hd.migrants);
+			}
+			for (int k = 0; k < numIn; k++) {
+				const Header &hd = in[k].header();
+				const Record *r = in[k].records() + hd.migrants;
+				ghosts.insert(ghosts.end(), r, r + hd.ghosts);
+			}
+			for (const Record &r : migrants[0])
+				if (r.px >= lo - h) ghosts.push_back(r);
+			for (const Record &r : migrants[1])
+				if (r.px < hi + h) ghosts.push_back(r);
+
+			size_t n = owned.size(), total = n + ghosts.size();
+			local.resize(total);
+			ids.resize(total);
+			for (size_t k = 0; k < total; k++) {
+				const Record &r = k < n ? owned[k] : ghosts[k - n];
+				local.setBoid(k, Boid{glm::vec3(r.px, r.py, r.pz), glm::vec3(r.vx, r.vy, r.vz), flock.boidRadius, r.maxSpeed, r.maxForce});
+				ids[k] = r.id;
+			}
+			local.streamIds = ids.data();
+			local.activeCount = n; // ghosts are neighbor input only
+			local.update(dt, physics);
+
+			// keep what is still inside, hand the rest to the neighbors next step
+			migrants[0].clear(), migrants[1].clear();
+			size_t kept = 0;
+			for (size_t k = 0; k < n; k++) {
+				Record r = record(local, k, ids[k]);
+				if (r.px < lo) migrants[0].push_back(r);
+				else if (r.px >= hi) migrants[1].push_back(r);
+				else owned[kept++] = r;
+			}
+			owned.resize(kept);
+
+			done++;
+			if (done == target) {
+				for (const Record &r : owned) output[r.id] = r;
+				for (int d = 0; d < 2; d++)
+					for (const Record &r : migrants[d]) output[r.id] = r;
+				control->owned[s].store(uint32_t(owned.size() + migrants[0].size() + migrants[1].size()), std::memory_order_relaxed);
+			}
+			control->reached[s].store(done, std::memory_order_release);
+		}
+	}
+};
+
+} // namespace oglprojs
+
+#endif // __linux__
+#endif // OGLPROJ4_SLABS_H
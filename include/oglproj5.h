@@ -4,22 +4,26 @@
 #include "oglprojs.h"
 
 #include "oglproj4.h"
+#include "oglprojs_parallel.h"
+#include "oglprojs_simd.h"
 
+#include <array>
 #include <numeric>
 
 namespace oglprojs {
 class PerlinNoise {
+	using f8 = simd::f8;
+
   public:
 	explicit PerlinNoise(unsigned int seed = 2019) {
-		p.resize(256);
-		std::iota(p.begin(), p.end(), 0);
+		std::iota(p.begin(), p.begin() + 256, 0);
 		std::mt19937 gen(seed);
-		std::shuffle(p.begin(), p.end(), gen);
+		std::shuffle(p.begin(), p.begin() + 256, gen);
 		// duplicate
-		p.insert(p.end(), p.begin(), p.end());
+		std::copy(p.begin(), p.begin() + 256, p.begin() + 256);
 	}
 
-	// 3D Perlin noise in [-1,1]
+	// 3D Perlin noise in [-1,1] (double precision, one point: the reference for the batched float versions)
 	double noise(double x, double y, double z) const {
 		// find unit cube that contains point
 		int X = (int)floor(x) & 255;
@@ -50,6 +54,31 @@ class PerlinNoise {
 		return res;
 	}
 
+	// 3D Perlin noise at 8 points in float precision (AVX2: hashes through gathers on the byte table)
+	f8 noise(f8 x, f8 y, f8 z) const {
+		f8 fx = simd::floor(x), fy = simd::floor(y), fz = simd::floor(z);
+		x = x - fx, y = y - fy, z = z - fz;
+		f8 u = fade(x), v = fade(y), w = fade(z);
+		const f8 one = 1.0f;
+		f8 x1 = x - one, y1 = y - one, z1 = z - one;
+
+		// corner hashes in the order AA, BA, AB, BB, AA + 1, BA + 1, AB + 1, BB + 1
+		CornerHashes h = hashCorners(fx, fy, fz);
+		return lerp(w, lerp(v, lerp(u, grad(h, 0, x, y, z), grad(h, 1, x1, y, z)), lerp(u, grad(h, 2, x, y1, z), grad(h, 3, x1, y1, z))),
+		            lerp(v, lerp(u, grad(h, 4, x, y, z1), grad(h, 5, x1, y, z1)), lerp(u, grad(h, 6, x, y1, z1), grad(h, 7, x1, y1, z1))));
+	}
+
+	// float noise over arrays of count points, 8 at a time
+	void noise(const float *x, const float *y, const float *z, float *out, size_t count) const {
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) noise(f8::load(x + i), f8::load(y + i), f8::load(z + i)).store(out + i);
+		if (i == count) return;
+		float tx[8] = {}, ty[8] = {}, tz[8] = {}, tout[8];
+		std::copy(x + i, x + count, tx), std::copy(y + i, y + count, ty), std::copy(z + i, z + count, tz);
+		noise(f8::load(tx), f8::load(ty), f8::load(tz)).store(tout);
+		std::copy(tout, tout + (count - i), out + i);
+	}
+
 	double normalizedNoise(double x, double y, double z, float nF = 0.6f, float nA = 1.0f, float nTS = 0.8f, double max = 1,
 	                       double min = 0) {
 		double nx = x * nF;
@@ -61,7 +90,8 @@ class PerlinNoise {
 	}
 
   private:
-	std::vector<int> p;
+	// permutation duplicated to 512 entries, plus 3 bytes so a 32-bit gather at entry 511 stays in bounds
+	std::array<uint8_t, 512 + 3> p{};
 	static inline double fade(double t) { return t * t * t * (t * (t * 6 - 15) + 10); }
 	static inline double lerp(double t, double a, double b) { return a + t * (b - a); }
 	static double grad(int hash, double x, double y, double z) {
@@ -70,9 +100,185 @@ class PerlinNoise {
 		double v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
 		return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
 	}
+
+	static inline f8 fade(f8 t) { return t * t * t * (t * (t * f8(6.0f) - f8(15.0f)) + f8(10.0f)); }
+	static inline f8 lerp(f8 t, f8 a, f8 b) { return a + t * (b - a); }
+
+#if defined(__AVX2__)
+	struct CornerHashes {
+		__m256i h[8];
+		const __m256i &operator[](int corner) const { return h[corner]; }
+	};
+
+	__m256i perm(__m256i i) const {
+		return _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int *>(p.data()), i, 1), _mm256_set1_epi32(255));
+	}
+
+	CornerHashes hashCorners(f8 fx, f8 fy, f8 fz) const {
+		const __m256i mask = _mm256_set1_epi32(255), one = _mm256_set1_epi32(1);
+		__m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx.v), mask);
+		__m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(fy.v), mask);
+		__m256i Z = _mm256_and_si256(_mm256_cvttps_epi32(fz.v), mask);
+		__m256i A = _mm256_add_epi32(perm(X), Y), B = _mm256_add_epi32(perm(_mm256_add_epi32(X, one)), Y);
+		__m256i AA = _mm256_add_epi32(perm(A), Z), AB = _mm256_add_epi32(perm(_mm256_add_epi32(A, one)), Z);
+		__m256i BA = _mm256_add_epi32(perm(B), Z), BB = _mm256_add_epi32(perm(_mm256_add_epi32(B, one)), Z);
+		return {{perm(AA), perm(BA), perm(AB), perm(BB), perm(_mm256_add_epi32(AA, one)), perm(_mm256_add_epi32(BA, one)),
+		         perm(_mm256_add_epi32(AB, one)), perm(_mm256_add_epi32(BB, one))}};
+	}
+
+	// same selection as the scalar grad(), with integer compares as lane masks and the signs xor-ed in
+	static f8 grad(const CornerHashes &hashes, int corner, f8 x, f8 y, f8 z) {
+		__m256i h = _mm256_and_si256(hashes[corner], _mm256_set1_epi32(15));
+		__m256 lt8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+		__m256 lt4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+		__m256i h12 = _mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)), h14 = _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14));
+		__m256 xv = _mm256_castsi256_ps(_mm256_or_si256(h12, h14));
+		__m256 u = _mm256_blendv_ps(y.v, x.v, lt8);
+		__m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z.v, x.v, xv), y.v, lt4);
+		u = _mm256_xor_ps(u, _mm256_castsi256_ps(_mm256_slli_epi32(h, 31)));
+		v = _mm256_xor_ps(v, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(h, 1), 31)));
+		return _mm256_add_ps(u, v);
+	}
+#else
+	// per corner, the gradient of each lane as table entries (grad() is a dot with a vector of 0 and +-1)
+	struct CornerHashes {
+		alignas(32) float gx[8][8], gy[8][8], gz[8][8];
+	};
+
+	CornerHashes hashCorners(f8 fx, f8 fy, f8 fz) const {
+		static constexpr float tx[16] = {1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0, 1, 0, -1, 0};
+		static constexpr float ty[16] = {1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1, 1, -1, 1, -1};
+		static constexpr float tz[16] = {0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1, 0, 1, 0, -1};
+		alignas(32) float bx[8], by[8], bz[8];
+		fx.store(bx), fy.store(by), fz.store(bz);
+		CornerHashes out;
+		for (int l = 0; l < 8; l++) {
+			int X = (int)bx[l] & 255, Y = (int)by[l] & 255, Z = (int)bz[l] & 255;
+			int A = p[X] + Y, AA = p[A] + Z, AB = p[A + 1] + Z;
+			int B = p[X + 1] + Y, BA = p[B] + Z, BB = p[B + 1] + Z;
+			const int corners[8] = {p[AA], p[BA], p[AB], p[BB], p[AA + 1], p[BA + 1], p[AB + 1], p[BB + 1]};
+			for (int c = 0; c < 8; c++) {
+				int h = corners[c] & 15;
+				out.gx[c][l] = tx[h], out.gy[c][l] = ty[h], out.gz[c][l] = tz[h];
+			}
+		}
+		return out;
+	}
+
+	static f8 grad(const CornerHashes &hashes, int corner, f8 x, f8 y, f8 z) {
+		return f8::load(hashes.gx[corner]) * x + f8::load(hashes.gy[corner]) * y + f8::load(hashes.gz[corner]) * z;
+	}
+#endif
+};
+
+// 3D simplex noise with analytic gradients. Each point reads only the 4 corners of its simplex. The 8-wide version
+// evaluates several independent fields (channels) in one simplex walk: the corners and falloff are shared, and only
+// the gradient hash changes per channel.
+class SimplexNoise {
+	using f8 = simd::f8;
+	using v3x8 = simd::v3x8;
+
+  public:
+	explicit SimplexNoise(unsigned int seed = 2019) {
+		std::iota(p.begin(), p.begin() + 256, 0);
+		std::mt19937 gen(seed);
+		std::shuffle(p.begin(), p.begin() + 256, gen);
+		std::copy(p.begin(), p.begin() + 256, p.begin() + 256);
+	}
+
+	// noise in about [-1,1] for channel 0 or 1; the gradient is written when asked for (scalar reference)
+	float noise(float x, float y, float z, glm::vec3 *gradient = nullptr, int channel = 0) const {
+		// skew into the simplex lattice, find the cell and the corner order
+		float s = (x + y + z) * F3;
+		float i = std::floor(x + s), j = std::floor(y + s), k = std::floor(z + s);
+		float t = (i + j + k) * G3;
+		glm::vec3 x0(x - (i - t), y - (j - t), z - (k - t));
+		glm::vec3 g(x0.x >= x0.y, x0.y >= x0.z, x0.z >= x0.x), l = glm::vec3(1.0f) - g;
+		glm::vec3 o1 = glm::min(g, glm::vec3(l.z, l.x, l.y)), o2 = glm::max(g, glm::vec3(l.z, l.x, l.y));
+		const glm::vec3 offsets[4] = {glm::vec3(0.0f), o1, o2, glm::vec3(1.0f)};
+
+		int ii = int(i) & 255, jj = int(j) & 255, kk = int(k) & 255;
+		float value = 0.0f;
+		glm::vec3 grad(0.0f);
+		for (int c = 0; c < 4; c++) {
+			glm::vec3 d = x0 - offsets[c] + glm::vec3(G3 * float(c));
+			float f = 0.5f - glm::dot(d, d);
+			if (f <= 0.0f) continue;
+			int h = hash(ii + int(offsets[c].x), jj + int(offsets[c].y), kk + int(offsets[c].z), channel);
+			glm::vec3 gc(kGradX[h], kGradY[h], kGradZ[h]);
+			float f2 = f * f, f4 = f2 * f2, gd = glm::dot(gc, d);
+			value += f4 * gd;
+			grad += f4 * gc - 8.0f * f2 * f * gd * d;
+		}
+		if (gradient) *gradient = grad * kScale;
+		return value * kScale;
+	}
+
+	// Channels fields at 8 points: value[c] and its gradient[c]
+	template <int Channels> void noise(const v3x8 &pt, f8 (&value)[Channels], v3x8 (&gradient)[Channels]) const {
+		static_assert(Channels >= 1 && Channels <= 2, "the hash offsets cover two channels");
+		const f8 zero = 0.0f, one = 1.0f;
+		f8 s = (pt.x + pt.y + pt.z) * f8(F3);
+		f8 i = simd::floor(pt.x + s), j = simd::floor(pt.y + s), k = simd::floor(pt.z + s);
+		f8 t = (i + j + k) * f8(G3);
+		v3x8 x0(pt.x - (i - t), pt.y - (j - t), pt.z - (k - t));
+		v3x8 g(simd::select(x0.x >= x0.y, one, zero), simd::select(x0.y >= x0.z, one, zero), simd::select(x0.z >= x0.x, one, zero));
+		v3x8 l(one - g.z, one - g.x, one - g.y); // (1 - g).zxy
+		v3x8 o1(simd::min(g.x, l.x), simd::min(g.y, l.y), simd::min(g.z, l.z));
+		v3x8 o2(simd::max(g.x, l.x), simd::max(g.y, l.y), simd::max(g.z, l.z));
+
+		// hash the 4 corners per lane, then gather their gradients into lane arrays
+		alignas(32) float bi[8], bj[8], bk[8], b1[3][8], b2[3][8];
+		alignas(32) float gx[Channels][4][8], gy[Channels][4][8], gz[Channels][4][8];
+		i.store(bi), j.store(bj), k.store(bk);
+		o1.store(b1[0], b1[1], b1[2]), o2.store(b2[0], b2[1], b2[2]);
+		for (int lane = 0; lane < 8; lane++) {
+			int ii = int(bi[lane]) & 255, jj = int(bj[lane]) & 255, kk = int(bk[lane]) & 255;
+			const int corner[4][3] = {{0, 0, 0},
+			                          {int(b1[0][lane]), int(b1[1][lane]), int(b1[2][lane])},
+			                          {int(b2[0][lane]), int(b2[1][lane]), int(b2[2][lane])},
+			                          {1, 1, 1}};
+			for (int c = 0; c < 4; c++) {
+				int h0 = p[ii + corner[c][0] + p[jj + corner[c][1] + p[kk + corner[c][2]]]];
+				for (int ch = 0; ch < Channels; ch++) {
+					int h = channelHash(h0, ch);
+					gx[ch][c][lane] = kGradX[h], gy[ch][c][lane] = kGradY[h], gz[ch][c][lane] = kGradZ[h];
+				}
+			}
+		}
+
+		for (int ch = 0; ch < Channels; ch++) value[ch] = zero, gradient[ch] = v3x8(zero, zero, zero);
+		const v3x8 offsets[4] = {v3x8(zero, zero, zero), o1, o2, v3x8(one, one, one)};
+		for (int c = 0; c < 4; c++) {
+			f8 shift = G3 * float(c);
+			v3x8 d(x0.x - offsets[c].x + shift, x0.y - offsets[c].y + shift, x0.z - offsets[c].z + shift);
+			f8 f = simd::max(f8(0.5f) - simd::dot(d, d), zero);
+			f8 f2 = f * f, f4 = f2 * f2, f3x8 = f2 * f * f8(8.0f);
+			for (int ch = 0; ch < Channels; ch++) {
+				v3x8 gc = v3x8::load(gx[ch][c], gy[ch][c], gz[ch][c]);
+				f8 gd = simd::dot(gc, d);
+				value[ch] += f4 * gd;
+				gradient[ch] += gc * f4 - d * (f3x8 * gd);
+			}
+		}
+		for (int ch = 0; ch < Channels; ch++) value[ch] *= f8(kScale), gradient[ch] = gradient[ch] * f8(kScale);
+	}
+
+  private:
+	static constexpr float F3 = 1.0f / 3.0f, G3 = 1.0f / 6.0f;
+	static constexpr float kScale = 76.0f; // brings the sum of the 4 corners to about [-1,1] (falloff radius^2 0.5)
+	// cube edge directions, 12 of them plus 4 repeats so a hash picks one with & 15
+	static constexpr float kGradX[16] = {1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0, 1, 0, -1, 0};
+	static constexpr float kGradY[16] = {1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1, 1, -1, 1, -1};
+	static constexpr float kGradZ[16] = {0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1, 0, 1, 0, -1};
+
+	std::array<uint8_t, 512> p{};
+
+	int channelHash(int h, int channel) const { return (channel == 0 ? h : p[(h + 101) & 255]) & 15; }
+	int hash(int i, int j, int k, int channel) const { return channelHash(p[i + p[j + p[k]]], channel); }
 };
 
-// Particle data
+// Particle data (one particle as seen through ParticleEmitter::particle; the emitter stores columns)
 struct Particle {
 	glm::vec3 position{0.0f};
 	glm::vec3 velocity{0.0f};
@@ -80,8 +286,6 @@ struct Particle {
 	float size = 0.1f;
 	float life = 0.0f;     // current age
 	float lifetime = 1.0f; // max age
-	float rotation = 0.0f;
-	float rotationSpeed = 0.0f;
 	bool alive() const { return life < lifetime; }
 };
 
@@ -92,6 +296,7 @@ struct EmitterParams {
 	int maxParticles = 2000;
 	bool burst = false;
 	int burstCount = 200;
+	unsigned int seed = 123456u; // key of the spawn and uniform-noise streams, read when the emitter is created
 
 	// lifetime/size/color
 	float lifetimeMin = 1.0f;
@@ -114,12 +319,19 @@ struct EmitterParams {
 	enum NoiseType {
 		NONE = 0,
 		UNIFORM = 1,
-		PERLIN = 2
+		PERLIN = 2,
+		CURL = 3 // divergence-free flow: cross product of two simplex gradients
 	} noiseType = PERLIN;
 	float noiseFrequency = 0.6f;
 	float noiseAmplitude = 1.0f;
 	float noiseTimeScale = 0.8f; // animate noise with time
 	unsigned int noiseSeed = 1337u;
+	int noiseOctaves = 1; // fBm: octave k has noiseFrequency * lacunarity^k and noiseAmplitude * gain^k
+	float noiseLacunarity = 2.0f;
+	float noiseGain = 0.5f;
+	bool noiseGrid = false;        // evaluate the noise once per frame on a lattice over the particles and interpolate
+	float noiseGridDensity = 8.0f; // lattice nodes per noise period (1 / noiseFrequency), bounds the interpolation error
+	int noiseGridMaxNodes = 64;    // per axis; very spread-out emitters get a coarser lattice
 
 	// spawn volume
 	enum SpawnShape {
@@ -136,183 +348,853 @@ struct EmitterParams {
 	// collision with physics spheres (turned off)
 	bool collideWithPhysics = false;
 	float restitution = 0.4f; // bounce when colliding with physics spheres
+
+	// rendering
+	bool depthSort = false; // renderAll draws back to front, in the order of the last sortByDepth()
+};
+
+// Physics bodies binned into a uniform grid once per step for particle collision. A body is listed in every cell its
+// bounds (grown by the largest particle size) overlap, so a particle only tests the entries of its own cell. Entries
+// are SoA columns, capsules as center and half axis and spheres with a zero axis, tested 8 at a time.
+struct BodyGrid {
+	using f8 = simd::f8;
+	using v3x8 = simd::v3x8;
+
+	glm::vec3 origin{0.0f};
+	float invCell = 1.0f;
+	glm::ivec3 dims{0};                 // no cells when there are no bodies
+	std::vector<unsigned> cellStart;    // cells + 1 offsets into the entries
+	std::vector<float> cx, cy, cz;      // body center per entry
+	std::vector<float> ax, ay, az;      // capsule half axis, zero for spheres
+	std::vector<float> invLen2, radius; // 1 / |half axis|^2 (zero for spheres) and body radius
+	std::vector<float> bvx, bvy, bvz;   // body velocity
+	float maxCellsPerBody = 16.0f;      // the cell grows when the bounds would need more cells
+
+	void build(const std::vector<RigidBody> &bodies, float margin) {
+		dims = glm::ivec3(0);
+		if (bodies.empty()) return;
+
+		// bounds per body, cell = mean bounds size
+		bounds.resize(bodies.size());
+		glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+		double meanSize = 0.0;
+		for (size_t i = 0; i < bodies.size(); i++) {
+			const RigidBody &b = bodies[i];
+			glm::vec3 a = b.shape == RigidBody::CAPSULE ? b.halfAxis : glm::vec3(0.0f), r(b.radius + margin);
+			bounds[i] = {glm::min(b.position - a, b.position + a) - r, glm::max(b.position - a, b.position + a) + r};
+			lo = glm::min(lo, bounds[i].first), hi = glm::max(hi, bounds[i].second);
+			glm::vec3 size = bounds[i].second - bounds[i].first;
+			meanSize += std::max(size.x, std::max(size.y, size.z));
+		}
+		float cell = std::max(float(meanSize / double(bodies.size())), 1e-3f);
+		glm::vec3 extent = hi - lo;
+		auto cellsFor = [&](float c) {
+			glm::dvec3 d = glm::floor(glm::dvec3(extent) / double(c)) + 1.0;
+			return d.x * d.y * d.z;
+		};
+		double total = cellsFor(cell), maxCells = std::max(1.0, double(bodies.size()) * maxCellsPerBody);
+		if (total > maxCells) cell *= float(std::cbrt(total / maxCells)) * 1.001f;
+		origin = lo;
+		invCell = 1.0f / cell;
+		dims = glm::ivec3(glm::floor(extent * invCell)) + 1;
+
+		// counting sort of (cell, body) entries, bodies in order within a cell
+		size_t numCells = size_t(dims.x) * dims.y * dims.z;
+		cellStart.assign(numCells + 1, 0);
+		auto forEachCell = [&](size_t i, auto fn) {
+			glm::ivec3 c0 = cellCoord(bounds[i].first), c1 = cellCoord(bounds[i].second);
+			for (int z = c0.z; z <= c1.z; z++)
+				for (int y = c0.y; y <= c1.y; y++)
+					for (int x = c0.x; x <= c1.x; x++) fn(size_t((z * dims.y + y) * dims.x + x));
+		};
+		for (size_t i = 0; i < bodies.size(); i++) forEachCell(i, [&](size_t c) { cellStart[c + 1]++; });
+		for (size_t c = 0; c < numCells; c++) cellStart[c + 1] += cellStart[c];
+		size_t entries = cellStart[numCells];
+		for (auto *c : {&cx, &cy, &cz, &ax, &ay, &az, &invLen2, &radius, &bvx, &bvy, &bvz}) c->resize(simd::paddedSize(entries));
+		cursor.assign(cellStart.begin(), cellStart.end() - 1);
+		for (size_t i = 0; i < bodies.size(); i++) {
+			const RigidBody &b = bodies[i];
+			glm::vec3 a = b.shape == RigidBody::CAPSULE ? b.halfAxis : glm::vec3(0.0f);
+			float len2 = glm::dot(a, a);
+			forEachCell(i, [&](size_t c) {
+				size_t k = cursor[c]++;
+				cx[k] = b.position.x, cy[k] = b.position.y, cz[k] = b.position.z;
+				ax[k] = a.x, ay[k] = a.y, az[k] = a.z;
+				invLen2[k] = len2 > 0.0f ? 1.0f / len2 : 0.0f, radius[k] = b.radius;
+				bvx[k] = b.velocity.x, bvy[k] = b.velocity.y, bvz[k] = b.velocity.z;
+			});
+		}
+	}
+
+	glm::ivec3 cellCoord(const glm::vec3 &p) const { return glm::clamp(glm::ivec3(glm::floor((p - origin) * invCell)), glm::ivec3(0), dims - 1); }
+
+	// cell of a point, -1 outside the grid (no body can reach it)
+	int cellOf(float x, float y, float z) const {
+		float gx = (x - origin.x) * invCell, gy = (y - origin.y) * invCell, gz = (z - origin.z) * invCell;
+		if (!(gx >= 0.0f && gy >= 0.0f && gz >= 0.0f && gx < float(dims.x) && gy < float(dims.y) && gz < float(dims.z))) return -1;
+		return (int(gz) * dims.y + int(gy)) * dims.x + int(gx);
+	}
+
+	// closest point of entry k's core (center or capsule segment) to p
+	glm::vec3 closestPoint(size_t k, const glm::vec3 &p) const {
+		glm::vec3 c(cx[k], cy[k], cz[k]), a(ax[k], ay[k], az[k]);
+		return c + a * glm::clamp(glm::dot(p - c, a) * invLen2[k], -1.0f, 1.0f);
+	}
+
+	// bit l set when p is closer than radius + size to the core of entry k + l, but not on it
+	unsigned overlaps(size_t k, const glm::vec3 &p, float size) const {
+		v3x8 a = v3x8::load(&ax[k], &ay[k], &az[k]);
+		v3x8 d = v3x8(f8(p.x), f8(p.y), f8(p.z)) - v3x8::load(&cx[k], &cy[k], &cz[k]);
+		f8 t = simd::min(simd::max(simd::dot(d, a) * f8::load(&invLen2[k]), f8(-1.0f)), f8(1.0f));
+		d -= a * t;
+		f8 d2 = simd::dot(d, d), reach = f8::load(&radius[k]) + f8(size);
+		return simd::bitmask((d2 < reach * reach) & (d2 > f8(1e-8f)));
+	}
+
+	// outline every cell that holds at least one body (debug overlay)
+	void debugDraw(DebugDraw &dd, const glm::vec4 &color) const {
+		float cell = 1.0f / invCell;
+		for (int z = 0; z < dims.z; z++)
+			for (int y = 0; y < dims.y; y++)
+				for (int x = 0; x < dims.x; x++) {
+					size_t c = size_t((z * dims.y + y) * dims.x + x);
+					if (cellStart[c] == cellStart[c + 1]) continue;
+					glm::vec3 lo = origin + glm::vec3(x, y, z) * cell;
+					dd.box(lo, lo + cell, color);
+				}
+	}
+
+	size_t memoryBytes() const {
+		size_t floats = 0;
+		for (auto *c : {&cx, &cy, &cz, &ax, &ay, &az, &invLen2, &radius, &bvx, &bvy, &bvz}) floats += c->capacity();
+		return floats * sizeof(float) + (cellStart.capacity() + cursor.capacity()) * sizeof(unsigned);
+	}
+
+  private:
+	std::vector<std::pair<glm::vec3, glm::vec3>> bounds; // per body (scratch)
+	std::vector<unsigned> cursor;                        // counting sort write positions
 };
 
 // Particle Emitter
 class ParticleEmitter {
+	using f8 = simd::f8;
+	using v3x8 = simd::v3x8;
+
   public:
-	ParticleEmitter(const EmitterParams &p = EmitterParams()) : params(p), perlin(p.noiseSeed), rng(123456) {
-		particles.reserve(params.maxParticles);
+	ParticleEmitter(const EmitterParams &p = EmitterParams()) : ParticleEmitter(p, size_t(std::max(p.maxParticles, 0))) {}
+
+	// fixed-capacity pool: every column is allocated once here, later frames never allocate
+	ParticleEmitter(const EmitterParams &p, size_t capacity) : params(p), perlin(p.noiseSeed), simplex(p.noiseSeed), random(p.seed) {
+		bind(nullptr, capacity);
 		emitAccumulator = 0.0f;
-		// pre-allocate pool
-		for (int i = 0; i < std::min(64, params.maxParticles); i++) particles.push_back(Particle());
 	}
 
+	// the columns may live in a ParticleSystem's pool, copies would alias them
+	ParticleEmitter(const ParticleEmitter &) = delete;
+	ParticleEmitter &operator=(const ParticleEmitter &) = delete;
+
+	// optional worker pool for spawning, noise, integration and collision. Random draws come from counter-based
+	// streams, so results are identical with or without a pool and for any thread count
+	ThreadPool *threadPool = nullptr;
+
 	void setTransform(const glm::mat4 &t) { worldTransform = t; }
 
 	// spawn N immediately (for burst)
 	void burst(int N) {
-		for (int i = 0; i < N; i++) spawnParticle();
+		spawnBatch(size_t(std::max(N, 0)));
 	}
 
 	// step simulation: dt seconds. Optionally can pass pointer to physics engine for collisions,
 	void update(float dt, PhysicsEngine *physics = nullptr, float timeNow = 0.0f) {
 		if (dt <= 0.0f) return;
+		beginStep(dt, physics, timeNow);
+		parallelFor(threadPool, 0, n, kChunk, [&](size_t b, size_t e) { stepChunk(b, e); });
+		endStep();
+	}
+
+	// draw particles using a provided render callback. The render callback receives (modelMat, color, size)
+	// call Application::renderMesh by passing the model matrix computed for each particle.
+	template <typename RenderCallback> void renderAll(RenderCallback renderCb) {
+		bool sorted = params.depthSort && orderFresh;
+		for (size_t k = 0; k < n; k++) {
+			size_t i = sorted ? order[k] : k;
+			if (!(life[i] < lifetime[i])) continue;
+			glm::mat4 model =
+			    glm::translate(glm::mat4(1.0f), glm::vec3(px[i], py[i], pz[i])) * glm::scale(glm::mat4(1.0f), glm::vec3(size[i]));
+			renderCb(model, glm::vec4(cr[i], cg[i], cb[i], ca[i]), size[i]);
+		}
+	}
 
+	// order the particles back to front for view (after update, before renderAll). The last order is kept pointing at
+	// the same particles through the swap-removes; when the particles and camera move little it is still nearly sorted
+	// and an insertion sort finishes it. If that would move more than 2 entries per particle, the 16-bit quantized
+	// view depths are radix sorted instead (two 8-bit passes, a pass is skipped when all keys share its digit)
+	void sortByDepth(const glm::mat4 &view) {
+		if (orderPos.size() != capacity) {
+			orderPos.assign(capacity, kUnordered);
+			order.resize(capacity), orderScratch.resize(capacity);
+			depthKey.resize(capacity), keyScratch.resize(capacity);
+			depth.resize(simd::paddedSize(capacity));
+			orderCount = 0;
+		}
+
+		// view-space z (larger is nearer) and its range, 8 particles at a time
+		const f8 rx = view[0][2], ry = view[1][2], rz = view[2][2], rw = view[3][2];
+		float lo = std::numeric_limits<float>::max(), hi = std::numeric_limits<float>::lowest();
+		size_t i = 0;
+		if (n >= 8) {
+			f8 l = lo, h = hi;
+			for (; i + 8 <= n; i += 8) {
+				f8 z = rx * f8::load(&px[i]) + ry * f8::load(&py[i]) + rz * f8::load(&pz[i]) + rw;
+				z.store(&depth[i]);
+				l = simd::min(l, z), h = simd::max(h, z);
+			}
+			alignas(32) float ls[8], hs[8];
+			l.store(ls), h.store(hs);
+			for (int k = 0; k < 8; k++) lo = std::min(lo, ls[k]), hi = std::max(hi, hs[k]);
+		}
+		for (; i < n; i++) {
+			depth[i] = view[0][2] * px[i] + view[1][2] * py[i] + view[2][2] * pz[i] + view[3][2];
+			lo = std::min(lo, depth[i]), hi = std::max(hi, depth[i]);
+		}
+
+		// the last order helps only while the scene is nearly static: after a radix fallback it is retried every 8th sort,
+		// in between the pool order goes straight to the radix sort
+		bool fromLast = orderCount > 0 && fallbacks % 8 == 0;
+		size_t m = 0;
+		if (fromLast) {
+			// the last order without the dead, then the particles it does not know (spawned since, or never sorted)
+			for (size_t k = 0; k < orderCount; k++)
+				if (order[k] != kUnordered) order[m++] = order[k];
+			for (size_t slot = 0; slot < n; slot++)
+				if (orderPos[slot] == kUnordered) order[m++] = uint32_t(slot);
+		} else {
+			for (; m < n; m++) order[m] = uint32_t(m);
+		}
+
+		// keys; with few descents the order is nearly sorted and insertion finishes it
+		float scale = hi > lo ? 65535.0f / (hi - lo) : 0.0f;
+		size_t descents = 0;
+		for (size_t k = 0; k < m; k++) {
+			depthKey[k] = uint16_t((depth[order[k]] - lo) * scale);
+			descents += k > 0 && depthKey[k] < depthKey[k - 1];
+		}
+		bool sorted = descents == 0 || (fromLast && descents <= m / 64 && insertionSortOrder(m, 2 * m));
+		if (!sorted) radixSortOrder(m);
+		fallbacks = sorted ? 0 : fallbacks + 1;
+
+		for (size_t k = 0; k < m; k++) orderPos[order[k]] = uint32_t(k);
+		orderCount = m;
+		orderFresh = true;
+	}
+
+	// Create one particle and push to pool if under max
+	void spawnParticle() { spawnBatch(1); }
+
+	// feed particles (as points, optionally with velocities and the occupied collider cells) to a debug batcher
+	void debugDraw(DebugDraw &dd, bool velocities = false, bool cells = false) const {
+		for (size_t i = 0; i < n; i++) {
+			glm::vec4 color(cr[i], cg[i], cb[i], ca[i]);
+			dd.point(glm::vec3(px[i], py[i], pz[i]), color);
+			if (velocities) dd.arrow(glm::vec3(px[i], py[i], pz[i]), glm::vec3(vx[i], vy[i], vz[i]) * 0.1f, color);
+		}
+		if (cells) bodyGrid.debugDraw(dd, glm::vec4(0.2f, 0.8f, 1.0f, 0.3f));
+	}
+
+	// helper to set color/size over lifetime (call before render), 8 particles at a time
+	void applyMorphs() {
+		const f8 zero = 0.0f, one = 1.0f;
+		const glm::vec4 &a = params.colorStart, &b = params.colorEnd;
+		parallelFor(threadPool, 0, n, kChunk, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i += 8) {
+				f8 t = simd::min(simd::max(f8::load(&life[i]) / f8::load(&lifetime[i]), zero), one);
+				f8 s = one - t;
+				(f8(a.r) * s + f8(b.r) * t).store(&cr[i]);
+				(f8(a.g) * s + f8(b.g) * t).store(&cg[i]);
+				(f8(a.b) * s + f8(b.b) * t).store(&cb[i]);
+				(f8(a.a) * s + f8(b.a) * t).store(&ca[i]);
+				// curves or texture-based ramps can be made, but again you may call me lazy
+			}
+		});
+	}
+
+	EmitterParams params;
+	void clear() {
+		n = 0;
+		std::fill(orderPos.begin(), orderPos.end(), kUnordered);
+		orderCount = 0, orderFresh = false;
+	}
+	size_t aliveCount() const { return n; }
+
+	Particle particle(size_t i) const {
+		Particle p;
+		p.position = glm::vec3(px[i], py[i], pz[i]);
+		p.velocity = glm::vec3(vx[i], vy[i], vz[i]);
+		p.color = glm::vec4(cr[i], cg[i], cb[i], ca[i]);
+		p.size = size[i];
+		p.life = life[i];
+		p.lifetime = lifetime[i];
+		return p;
+	}
+
+  private:
+	friend class ParticleSystem;
+
+	// particle state as SoA columns, padded with simd::paddedSize(); entries [0, n) are particles. The columns live in
+	// storage, or in a ParticleSystem's pool
+	static constexpr int kColumns = 13;
+	float *px = nullptr, *py = nullptr, *pz = nullptr, *vx = nullptr, *vy = nullptr, *vz = nullptr;
+	float *life = nullptr, *lifetime = nullptr, *size = nullptr;
+	float *cr = nullptr, *cg = nullptr, *cb = nullptr, *ca = nullptr;
+	std::vector<float> storage;
+	std::vector<float> noiseX, noiseY, noiseZ; // per-step turbulence (scratch)
+	std::vector<uint32_t> dying;               // particles that died this step, per chunk then merged (scratch)
+	std::vector<size_t> chunkDead;             // deaths per chunk (scratch)
+	std::vector<glm::vec3> chunkLo, chunkHi;   // live bounds per chunk (scratch)
+	static constexpr size_t kChunk = 4096;     // particles per pool task, a multiple of 8
+	size_t n = 0;                              // live particles, stored in [0, n)
+	size_t capacity = 0;                       // params.maxParticles at creation, or the quota in a ParticleSystem
+
+	glm::mat4 worldTransform = glm::mat4(1.0f);
+	PerlinNoise perlin;
+	SimplexNoise simplex;
+	Philox random; // keyed by params.seed; stream d holds draw d of every spawn, indexed by spawn number
+	float emitAccumulator = 0.0f;
+	uint64_t spawned = 0, updates = 0;                   // stream positions: spawns and updates so far
+	static constexpr uint64_t kNoiseStream = 1ull << 63; // uniform noise of update u uses streams kNoiseStream + 3 u + axis
+
+	std::array<float *, kColumns> columns() const { return {px, py, pz, vx, vy, vz, life, lifetime, size, cr, cg, cb, ca}; }
+
+	// move the particles into kColumns columns of simd::paddedSize(newCapacity) floats at block, or into the emitter's
+	// own storage when block is null; particles past the new capacity are dropped
+	void bind(float *block, size_t newCapacity) {
+		size_t stride = simd::paddedSize(newCapacity), keep = std::min(n, newCapacity);
+		std::vector<float> own;
+		if (!block) {
+			own.assign(kColumns * stride, 0.0f);
+			block = own.data();
+		}
+		std::array<float **, kColumns> refs = {&px, &py, &pz, &vx, &vy, &vz, &life, &lifetime, &size, &cr, &cg, &cb, &ca};
+		for (int c = 0; c < kColumns; c++) {
+			if (*refs[c]) std::copy_n(*refs[c], keep, block + c * stride);
+			*refs[c] = block + c * stride;
+		}
+		storage.swap(own); // frees the previous own storage, if any
+		capacity = newCapacity, n = keep;
+		for (auto *c : {&noiseX, &noiseY, &noiseZ}) c->assign(stride, 0.0f);
+		dying.resize(capacity);
+		order.clear(), orderPos.clear(), orderCount = 0, orderFresh = false; // sortByDepth reallocates for the new capacity
+		chunkDead.resize(capacity / kChunk + 1);
+		chunkLo.resize(capacity / kChunk + 1), chunkHi.resize(capacity / kChunk + 1);
+	}
+
+	// one step is emission and the noise lattice (beginStep), independent chunks of kChunk particles (stepChunk, on
+	// any thread) and the removal of the dead (endStep); ParticleSystem batches the chunks of all its emitters
+	struct StepState {
+		float dt = 0.0f, time = 0.0f;
+		const BodyGrid *colliders = nullptr; // null unless colliding
+		uint64_t frame = 0;                  // uniform-noise stream of this step
+	} stepState;
+
+	// colliders: bodies already binned for this step (by a ParticleSystem), otherwise the emitter bins them itself
+	void beginStep(float dt, PhysicsEngine *physics, float timeNow, const BodyGrid *colliders = nullptr) {
 		// emit particles (continuous)
 		if (!params.burst) {
 			float toEmit = params.emitRate * dt + emitAccumulator;
 			int count = (int)floor(toEmit);
 			emitAccumulator = toEmit - float(count);
-			for (int i = 0; i < count; i++) spawnParticle();
+			spawnBatch(size_t(count));
 		}
 
 		// burst handled externally or by calling burst(), you may call me lazy
 
-		// update particles
-		for (auto &pt : particles) {
-			if (!pt.alive()) continue;
-			pt.life += dt;
-			if (!pt.alive()) continue;
-
-			glm::vec3 noiseVec(0.0f);
-			if (params.noiseType == EmitterParams::PERLIN) {
-				// sample Perlin at particle position + time
-				double s = perlin.noise(pt.position.x * params.noiseFrequency, pt.position.y * params.noiseFrequency,
-				                        timeNow * params.noiseTimeScale);
-				double s2 = perlin.noise((pt.position.x + 37.1) * params.noiseFrequency, (pt.position.y + 17.3) * params.noiseFrequency,
-				                         (timeNow + 5.1) * params.noiseTimeScale);
-				double s3 = perlin.noise((pt.position.x - 12.7) * params.noiseFrequency, (pt.position.y + 93.4) * params.noiseFrequency,
-				                         (timeNow + 11.2) * params.noiseTimeScale);
-				noiseVec = glm::vec3((float)s, (float)s2, (float)s3) * params.noiseAmplitude;
-			} else if (params.noiseType == EmitterParams::UNIFORM) {
-				noiseVec = glm::vec3(randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f)) * params.noiseAmplitude;
+		if (params.noiseGrid && (params.noiseType == EmitterParams::PERLIN || params.noiseType == EmitterParams::CURL))
+			buildNoiseGrid(timeNow);
+		if (params.collideWithPhysics && physics && !colliders) {
+			bodyGrid.build(physics->bodies, collisionMargin());
+			colliders = &bodyGrid;
+		}
+		stepState = {dt, timeNow, params.collideWithPhysics && physics ? colliders : nullptr, updates++};
+	}
+
+	void stepChunk(size_t b, size_t e) {
+		const float dt = stepState.dt, timeNow = stepState.time;
+
+		// turbulence: Perlin or curl noise per particle or through the cached lattice, or uniform noise
+		bool noisy = params.noiseType != EmitterParams::NONE;
+		if (params.noiseType == EmitterParams::PERLIN || params.noiseType == EmitterParams::CURL) {
+			if (params.noiseGrid) {
+				for (size_t i = b; i < e; i++) {
+					glm::vec3 v = noiseGrid.sample(px[i], py[i], pz[i]);
+					noiseX[i] = v.x, noiseY[i] = v.y, noiseZ[i] = v.z;
+				}
+			} else {
+				turbulence(&px[b], &py[b], &pz[b], e - b, &noiseX[b], &noiseY[b], &noiseZ[b], timeNow);
 			}
+		} else if (params.noiseType == EmitterParams::UNIFORM) {
+			uint64_t stream = kNoiseStream + 3 * stepState.frame;
+			float amp = params.noiseAmplitude;
+			random.fill(stream, b, &noiseX[b], e - b, -amp, amp);
+			random.fill(stream + 1, b, &noiseY[b], e - b, -amp, amp);
+			random.fill(stream + 2, b, &noiseZ[b], e - b, -amp, amp);
+		}
 
-			// integrate velocity with gravity + noise
-			pt.velocity += (params.gravity + noiseVec) * dt;
-
-			// drag
-			pt.velocity *= (1.0f / (1.0f + params.drag * dt));
-
-			// integrate position
-			pt.position += pt.velocity * dt;
-
-			// simple collision with physics spheres (bounce)
-			if (params.collideWithPhysics && physics) {
-				for (auto &b : physics->bodies) {
-					glm::vec3 diff = pt.position - b.position;
-					float d2 = glm::dot(diff, diff);
-					float r2 = (b.radius + pt.size) * (b.radius + pt.size);
-					if (d2 < r2 && d2 > 1e-8f) {
-						float d = sqrt(d2);
-						glm::vec3 n = diff / d;
-						// reflect velocity
-						float vAlong = glm::dot(pt.velocity, n);
-						if (vAlong < 0.0f) { pt.velocity -= (1.0f + params.restitution) * vAlong * n; }
-						// push out
-						pt.position = b.position + n * (b.radius + pt.size + 1e-3f);
+		// age, gravity + noise, drag and position, 8 particles at a time (lanes that die this step keep their state).
+		// The chunk lists its dead in ascending order at its own offset in dying
+		const f8 fdt = dt, dragScale = 1.0f / (1.0f + params.drag * dt);
+		const v3x8 gravity(params.gravity.x, params.gravity.y, params.gravity.z);
+		size_t dead = 0;
+		for (size_t i = b; i < e; i += 8) {
+			f8 age = f8::load(&life[i]) + fdt;
+			f8 alive = age < f8::load(&lifetime[i]);
+			v3x8 p = v3x8::load(&px[i], &py[i], &pz[i]);
+			v3x8 v = v3x8::load(&vx[i], &vy[i], &vz[i]);
+			v3x8 force = noisy ? gravity + v3x8::load(&noiseX[i], &noiseY[i], &noiseZ[i]) : gravity;
+			v3x8 nv = (v + force * fdt) * dragScale;
+			simd::select(alive, p + nv * fdt, p).store(&px[i], &py[i], &pz[i]);
+			simd::select(alive, nv, v).store(&vx[i], &vy[i], &vz[i]);
+			age.store(&life[i]);
+			unsigned died = simd::bitmask(alive) ^ 0xFFu;
+			if (e - i < 8) died &= (1u << (e - i)) - 1u;
+			for (; died; died &= died - 1) dying[b + dead++] = uint32_t(i + std::countr_zero(died));
+		}
+		chunkDead[b / kChunk] = dead;
+
+		// simple collision with physics spheres (bounce): a particle tests the bodies binned into its cell, 8 at a time,
+		// and resolves the hits in body order
+		if (const BodyGrid *grid = stepState.colliders) {
+			for (size_t i = b; i < e; i++) {
+				if (!(life[i] < lifetime[i])) continue;
+				int cell = grid->cellOf(px[i], py[i], pz[i]);
+				if (cell < 0) continue;
+				glm::vec3 position(px[i], py[i], pz[i]), velocity(vx[i], vy[i], vz[i]);
+				bool hit = false;
+				for (size_t k = grid->cellStart[cell], end = grid->cellStart[cell + 1]; k < end; k += 8) {
+					unsigned lanes = end - k < 8 ? (1u << (end - k)) - 1u : 0xFFu;
+					for (unsigned hits = grid->overlaps(k, position, size[i]) & lanes; hits;) {
+						unsigned l = unsigned(std::countr_zero(hits));
+						size_t j = k + l;
+						glm::vec3 center = grid->closestPoint(j, position);
+						glm::vec3 nrm = glm::normalize(position - center);
+						// reflect velocity (relative to the body, kinematic bones carry particles along)
+						float vAlong = glm::dot(velocity - glm::vec3(grid->bvx[j], grid->bvy[j], grid->bvz[j]), nrm);
+						if (vAlong < 0.0f) { velocity -= (1.0f + params.restitution) * vAlong * nrm; }
+						// push out, then retest the rest of the group from the new position
+						position = center + nrm * (grid->radius[j] + size[i] + 1e-3f);
+						hit = true;
+						hits = grid->overlaps(k, position, size[i]) & lanes & ~((2u << l) - 1u);
 					}
 				}
+				if (!hit) continue;
+				px[i] = position.x, py[i] = position.y, pz[i] = position.z;
+				vx[i] = velocity.x, vy[i] = velocity.y, vz[i] = velocity.z;
 			}
 		}
+	}
 
-		// remove dead particles lazily (compact)
-		if (particles.size() > 0) {
-			size_t write = 0;
-			for (size_t read = 0; read < particles.size(); read++) {
-				if (particles[read].alive()) {
-					if (write != read) particles[write] = particles[read];
-					write++;
-				}
+	void endStep() {
+		// merge the chunk lists (each lands at or before its own offset), then swap-remove the dead, highest index
+		// first: the last particle is then always alive when it fills the slot
+		size_t dead = 0;
+		for (size_t c = 0, chunks = (n + kChunk - 1) / kChunk; c < chunks; c++) {
+			std::copy_n(&dying[c * kChunk], chunkDead[c], &dying[dead]);
+			dead += chunkDead[c];
+		}
+		while (dead > 0) {
+			size_t i = dying[--dead], last = --n;
+			if (!orderPos.empty()) reorder(i, last);
+			if (i != last)
+				for (float *c : columns()) c[i] = c[last];
+		}
+		orderFresh = false;
+	}
+
+	// turbulence at count points, 8 at a time (arrays padded to a multiple of 8)
+	void turbulence(const float *x, const float *y, const float *z, size_t count, float *outX, float *outY, float *outZ,
+	                float timeNow) const {
+		int octaves = std::max(params.noiseOctaves, 1);
+		for (size_t i = 0; i < count; i += 8) {
+			v3x8 pos = v3x8::load(x + i, y + i, z + i);
+			v3x8 v = params.noiseType == EmitterParams::CURL ? curlNoise(pos, timeNow, octaves) : perlinNoise(pos, timeNow, octaves);
+			v.store(outX + i, outY + i, outZ + i);
+		}
+	}
+
+	// three Perlin samples over (x, y, time) at offsets that decorrelate the axes; z is not used
+	v3x8 perlinNoise(const v3x8 &pos, float timeNow, int octaves) const {
+		f8 freq = params.noiseFrequency, amp = params.noiseAmplitude, tscale = params.noiseTimeScale;
+		const f8 t1 = timeNow, t2 = timeNow + 5.1f, t3 = timeNow + 11.2f;
+		v3x8 sum(0.0f, 0.0f, 0.0f);
+		for (int o = 0; o < octaves; o++) {
+			sum.x += perlin.noise(pos.x * freq, pos.y * freq, t1 * tscale) * amp;
+			sum.y += perlin.noise((pos.x + f8(37.1f)) * freq, (pos.y + f8(17.3f)) * freq, t2 * tscale) * amp;
+			sum.z += perlin.noise((pos.x - f8(12.7f)) * freq, (pos.y + f8(93.4f)) * freq, t3 * tscale) * amp;
+			freq *= params.noiseLacunarity, tscale *= params.noiseLacunarity, amp *= params.noiseGain;
+		}
+		return sum;
+	}
+
+	// grad a x grad b of two fBm simplex fields, both from one simplex walk per octave. A cross product of two
+	// gradients has zero divergence; time slides the field along z
+	v3x8 curlNoise(const v3x8 &pos, float timeNow, int octaves) const {
+		const f8 freq = params.noiseFrequency;
+		v3x8 base(pos.x * freq, pos.y * freq, pos.z * freq + f8(timeNow * params.noiseTimeScale));
+		v3x8 ga(0.0f, 0.0f, 0.0f), gb(0.0f, 0.0f, 0.0f);
+		float lacunarity = 1.0f, weight = 1.0f; // octave gradients pick up lacunarity^k from the chain rule
+		for (int o = 0; o < octaves; o++) {
+			f8 value[2];
+			v3x8 gradient[2];
+			simplex.noise<2>(base * f8(lacunarity), value, gradient);
+			ga += gradient[0] * f8(weight * lacunarity), gb += gradient[1] * f8(weight * lacunarity);
+			lacunarity *= params.noiseLacunarity, weight *= params.noiseGain;
+		}
+		f8 scale = params.noiseAmplitude * kCurlScale;
+		return v3x8(ga.y * gb.z - ga.z * gb.y, ga.z * gb.x - ga.x * gb.z, ga.x * gb.y - ga.y * gb.x) * scale;
+	}
+	static constexpr float kCurlScale = 0.0617f; // RMS magnitude about 0.47 * amplitude, as the one-octave Perlin turbulence
+
+	// turbulence cached on a lattice over the live particles; z gets a single layer when the field ignores it
+	struct NoiseGrid {
+		glm::vec3 origin{0.0f};
+		float invSpacing = 1.0f;
+		int dims[3] = {1, 1, 1};
+		std::vector<float> x, y, z;    // node positions
+		std::vector<float> vx, vy, vz; // field at the nodes
+
+		// trilinear, or bilinear when the lattice has a single z layer; positions outside clamp to the border
+		glm::vec3 sample(float x, float y, float z) const {
+			float gx = std::min(std::max((x - origin.x) * invSpacing, 0.0f), float(dims[0] - 1));
+			float gy = std::min(std::max((y - origin.y) * invSpacing, 0.0f), float(dims[1] - 1));
+			int ix = std::min(int(gx), dims[0] - 2), iy = std::min(int(gy), dims[1] - 2);
+			float tx = gx - float(ix), ty = gy - float(iy);
+			size_t at = size_t(ix) + size_t(iy) * dims[0], row = size_t(dims[0]);
+			if (dims[2] == 1) return bilinear(at, row, tx, ty);
+			float gz = std::min(std::max((z - origin.z) * invSpacing, 0.0f), float(dims[2] - 1));
+			int iz = std::min(int(gz), dims[2] - 2);
+			float tz = gz - float(iz);
+			size_t layer = row * dims[1];
+			at += size_t(iz) * layer;
+			return glm::mix(bilinear(at, row, tx, ty), bilinear(at + layer, row, tx, ty), tz);
+		}
+
+		glm::vec3 bilinear(size_t at, size_t row, float tx, float ty) const {
+			auto lerp2 = [&](const std::vector<float> &v) {
+				float a = v[at] + tx * (v[at + 1] - v[at]);
+				float b = v[at + row] + tx * (v[at + row + 1] - v[at + row]);
+				return a + ty * (b - a);
+			};
+			return glm::vec3(lerp2(vx), lerp2(vy), lerp2(vz));
+		}
+	};
+	NoiseGrid noiseGrid;
+	BodyGrid bodyGrid; // colliders of a standalone emitter
+
+	// depth sort: order[k] is the slot drawn k-th and orderPos[slot] its place in order, kUnordered for particles
+	// the order does not know and for dead entries. Allocated by the first sortByDepth()
+	std::vector<uint32_t> order, orderPos, orderScratch;
+	std::vector<uint16_t> depthKey, keyScratch;
+	std::vector<float> depth;
+	size_t orderCount = 0, fallbacks = 0; // fallbacks: sorts in a row that needed the radix sort
+	bool orderFresh = false; // order covers the pool: sorted since the last spawn or removal
+	static constexpr uint32_t kUnordered = ~0u;
+
+	// slot i died and the particle in slot last moved into it: keep order pointing at the same particles
+	void reorder(size_t i, size_t last) {
+		if (orderPos[i] != kUnordered) order[orderPos[i]] = kUnordered;
+		if (i != last) {
+			orderPos[i] = orderPos[last];
+			if (orderPos[i] != kUnordered) order[orderPos[i]] = uint32_t(i);
+		}
+		orderPos[last] = kUnordered;
+	}
+
+	// insertion sort of (depthKey, order)[0, m) by key; false when it gave up after maxMoves shifts (the pairs are
+	// then only partly sorted)
+	bool insertionSortOrder(size_t m, size_t maxMoves) {
+		size_t moves = 0;
+		for (size_t k = 1; k < m; k++) {
+			uint16_t key = depthKey[k];
+			uint32_t slot = order[k];
+			size_t j = k;
+			for (; j > 0 && depthKey[j - 1] > key; j--, moves++) depthKey[j] = depthKey[j - 1], order[j] = order[j - 1];
+			depthKey[j] = key, order[j] = slot;
+			if (moves > maxMoves) return false;
+		}
+		return true;
+	}
+
+	// stable LSD radix sort of (depthKey, order)[0, m) by key
+	void radixSortOrder(size_t m) {
+		size_t count[2][256] = {};
+		for (size_t k = 0; k < m; k++) count[0][depthKey[k] & 255]++, count[1][depthKey[k] >> 8]++;
+		uint16_t *keys = depthKey.data(), *keysOut = keyScratch.data();
+		uint32_t *slots = order.data(), *slotsOut = orderScratch.data();
+		for (int pass = 0; pass < 2; pass++) {
+			int shift = 8 * pass;
+			if (count[pass][(keys[0] >> shift) & 255] == m) continue; // one digit for all keys, nothing moves
+			size_t at[256];
+			for (size_t d = 0, sum = 0; d < 256; d++) at[d] = sum, sum += count[pass][d];
+			for (size_t k = 0; k < m; k++) {
+				size_t to = at[(keys[k] >> shift) & 255]++;
+				keysOut[to] = keys[k], slotsOut[to] = slots[k];
 			}
-			particles.resize(write);
+			std::swap(keys, keysOut), std::swap(slots, slotsOut);
 		}
+		if (slots != order.data()) std::copy_n(slots, m, order.data()), std::copy_n(keys, m, depthKey.data());
 	}
 
-	// draw particles using a provided render callback. The render callback receives (modelMat, color, size)
-	// call Application::renderMesh by passing the model matrix computed for each particle.
-	template <typename RenderCallback> void renderAll(RenderCallback renderCb) {
-		for (const auto &pt : particles) {
-			if (!pt.alive()) continue;
-			glm::mat4 model = glm::translate(glm::mat4(1.0f), pt.position) * glm::scale(glm::mat4(1.0f), glm::vec3(pt.size));
-			renderCb(model, pt.color, pt.size);
+	// largest particle size: bodies are binned with this much margin
+	float collisionMargin() const { return std::max(params.sizeMin, params.sizeMax); }
+
+	// lay the lattice over the live bounds with noiseGridDensity nodes per noise period, then evaluate it
+	void buildNoiseGrid(float timeNow) {
+		// live bounds: per chunk on the pool, then over the chunks
+		parallelFor(threadPool, 0, n, kChunk, [&](size_t b, size_t e) {
+			glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+			size_t i = b;
+			if (e - b >= 8) {
+				f8 lx = f8::load(&px[b]), ly = f8::load(&py[b]), lz = f8::load(&pz[b]), hx = lx, hy = ly, hz = lz;
+				for (i = b + 8; i + 8 <= e; i += 8) {
+					f8 x = f8::load(&px[i]), y = f8::load(&py[i]), z = f8::load(&pz[i]);
+					lx = simd::min(lx, x), ly = simd::min(ly, y), lz = simd::min(lz, z);
+					hx = simd::max(hx, x), hy = simd::max(hy, y), hz = simd::max(hz, z);
+				}
+				alignas(32) float l[3][8], h[3][8];
+				lx.store(l[0]), ly.store(l[1]), lz.store(l[2]), hx.store(h[0]), hy.store(h[1]), hz.store(h[2]);
+				for (int a = 0; a < 3; a++)
+					for (int l8 = 0; l8 < 8; l8++) lo[a] = std::min(lo[a], l[a][l8]), hi[a] = std::max(hi[a], h[a][l8]);
+			}
+			for (; i < e; i++) lo = glm::min(lo, glm::vec3(px[i], py[i], pz[i])), hi = glm::max(hi, glm::vec3(px[i], py[i], pz[i]));
+			chunkLo[b / kChunk] = lo, chunkHi[b / kChunk] = hi;
+		});
+		glm::vec3 lo(0.0f), hi(0.0f);
+		for (size_t c = 0, chunks = (n + kChunk - 1) / kChunk; c < chunks; c++) {
+			lo = c == 0 ? chunkLo[c] : glm::min(lo, chunkLo[c]);
+			hi = c == 0 ? chunkHi[c] : glm::max(hi, chunkHi[c]);
 		}
+
+		const bool usesAxis[3] = {true, true, params.noiseType == EmitterParams::CURL}; // Perlin samples (x, y, time)
+		int maxNodes = std::max(params.noiseGridMaxNodes, 2);
+		float extent = 0.0f;
+		for (int a = 0; a < 3; a++)
+			if (usesAxis[a]) extent = std::max(extent, hi[a] - lo[a]);
+		float spacing = std::max(1.0f / (params.noiseFrequency * params.noiseGridDensity), extent / float(maxNodes - 1));
+		spacing = std::min(spacing, std::max(extent, 1e-3f));
+
+		NoiseGrid &g = noiseGrid;
+		g.origin = lo;
+		g.invSpacing = 1.0f / spacing;
+		for (int a = 0; a < 3; a++) g.dims[a] = usesAxis[a] ? std::clamp(int(std::ceil((hi[a] - lo[a]) / spacing)) + 1, 2, maxNodes) : 1;
+		size_t nodes = size_t(g.dims[0]) * g.dims[1] * g.dims[2];
+		for (auto *c : {&g.x, &g.y, &g.z, &g.vx, &g.vy, &g.vz}) c->resize(simd::paddedSize(nodes));
+		size_t at = 0;
+		for (int k = 0; k < g.dims[2]; k++)
+			for (int j = 0; j < g.dims[1]; j++)
+				for (int i2 = 0; i2 < g.dims[0]; i2++, at++) {
+					g.x[at] = lo.x + spacing * float(i2), g.y[at] = lo.y + spacing * float(j), g.z[at] = lo.z + spacing * float(k);
+				}
+		parallelFor(threadPool, 0, nodes, kChunk, [&](size_t b, size_t e) {
+			turbulence(&g.x[b], &g.y[b], &g.z[b], e - b, &g.vx[b], &g.vy[b], &g.vz[b], timeNow);
+		});
 	}
 
-	// Create one particle and push to pool if under max
-	void spawnParticle() {
-		if ((int)particles.size() >= params.maxParticles) return;
+	// spawn count particles (as many as fit) on the pool, kSpawnRun at a time: every random attribute is filled for the
+	// whole run from its own stream (8 blocks per Philox pass), then the particles are assembled from those arrays
+	void spawnBatch(size_t count) {
+		count = std::min(count, spawnRoom());
+		parallelFor(threadPool, 0, count, 1024, [&](size_t b, size_t e) {
+			alignas(32) float u[kDraws][kSpawnRun];
+			for (size_t r = b; r < e; r += kSpawnRun) {
+				size_t m = std::min(kSpawnRun, e - r);
+				uint64_t s = spawned + r;
+				const glm::vec3 &vmin = params.velocityMin, &vmax = params.velocityMax;
+				random.fill(kLifetime, s, u[kLifetime], m, params.lifetimeMin, params.lifetimeMax);
+				random.fill(kSize, s, u[kSize], m, params.sizeMin, params.sizeMax);
+				for (int a = 0; a < 3; a++) random.fill(kVelocity + a, s, u[kVelocity + a], m, vmin[a], vmax[a]);
+				if (params.spawnShape == EmitterParams::SPHERE) {
+					for (int a = 0; a < 3; a++) random.fill(kShape + a, s, u[kShape + a], m, -1.0f, 1.0f);
+					random.fill(kRadius, s, u[kRadius], m, 0.0f, 1.0f);
+				} else if (params.spawnShape == EmitterParams::BOX) {
+					for (int a = 0; a < 3; a++) random.fill(kShape + a, s, u[kShape + a], m, -0.5f, 0.5f);
+				}
+				for (size_t k = 0; k < m; k++) spawnAt(n + r + k, u, k);
+			}
+		});
+		spawned += count;
+		n += count;
+		if (count > 0) orderFresh = false;
+	}
 
-		Particle p;
-		p.life = 0.0f;
-		// if (params.noiseType == EmitterParams::PERLIN) {
-		// 	p.lifetime = perlin.normalizedNoise();
-		// 	p.size = perlin.normalizedNoise();
-		// } else {
-		p.lifetime = randFloat(params.lifetimeMin, params.lifetimeMax);
-		p.size = randFloat(params.sizeMin, params.sizeMax);
-		// }
-		p.color = params.colorStart;
+	// random attributes of a spawn, one Philox stream each
+	enum Draw { kLifetime, kSize, kVelocity, kShape = kVelocity + 3, kRadius = kShape + 3, kDraws };
+	static constexpr size_t kSpawnRun = 256;
 
+	// fill slot i with a new particle from column k of the run's random attributes
+	void spawnAt(size_t i, const float (&u)[kDraws][kSpawnRun], size_t k) {
 		// spawn position depends on shape
 		glm::vec3 localPos(0.0f);
-		if (params.spawnShape == EmitterParams::POINT) {
-			localPos = glm::vec3(0.0f);
-		} else if (params.spawnShape == EmitterParams::SPHERE) {
+		if (params.spawnShape == EmitterParams::SPHERE) {
 			// random point in sphere
-			glm::vec3 u(randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f));
-			float r = pow(randFloat(0.0f, 1.0f), 1.0f / 3.0f) * params.sphereRadius;
-			localPos = glm::normalize(u) * r;
-		} else { // BOX
-			localPos = glm::vec3(randFloat(-0.5f, 0.5f) * params.boxSize.x, randFloat(-0.5f, 0.5f) * params.boxSize.y,
-			                     randFloat(-0.5f, 0.5f) * params.boxSize.z);
+			glm::vec3 dir(u[kShape][k], u[kShape + 1][k], u[kShape + 2][k]);
+			float r = std::cbrt(u[kRadius][k]) * params.sphereRadius;
+			localPos = glm::normalize(dir) * r;
+		} else if (params.spawnShape == EmitterParams::BOX) {
+			localPos = glm::vec3(u[kShape][k], u[kShape + 1][k], u[kShape + 2][k]) * params.boxSize;
 		}
 
 		// transform into world if needed
 		glm::vec3 worldPos = localPos;
-		if (params.localSpace) {
-			glm::vec4 tp = worldTransform * glm::vec4(localPos, 1.0f);
-			worldPos = glm::vec3(tp);
-		}
-
-		p.position = worldPos;
+		if (params.localSpace) worldPos = glm::vec3(worldTransform * glm::vec4(localPos, 1.0f));
 
 		// initial velocity
-		glm::vec3 v(randFloat(params.velocityMin.x, params.velocityMax.x), randFloat(params.velocityMin.y, params.velocityMax.y),
-		            randFloat(params.velocityMin.z, params.velocityMax.z));
-		v *= params.spread;
-		p.velocity = v;
-		p.rotation = 0.0f;
-		p.rotationSpeed = randFloat(-2.0f, 2.0f);
-		particles.push_back(p);
+		glm::vec3 v = glm::vec3(u[kVelocity][k], u[kVelocity + 1][k], u[kVelocity + 2][k]) * params.spread;
+
+		px[i] = worldPos.x, py[i] = worldPos.y, pz[i] = worldPos.z;
+		vx[i] = v.x, vy[i] = v.y, vz[i] = v.z;
+		life[i] = 0.0f, lifetime[i] = u[kLifetime][k], size[i] = u[kSize][k];
+		const glm::vec4 &c = params.colorStart;
+		cr[i] = c.r, cg[i] = c.g, cb[i] = c.b, ca[i] = c.a;
+	}
+
+	size_t spawnRoom() const {
+		size_t limit = std::min(capacity, size_t(std::max(params.maxParticles, 0)));
+		return n < limit ? limit - n : 0;
+	}
+};
+
+// ============================================================================
+// ParticleSystem: many emitters over one particle pool of a fixed capacity. Every emitter owns a slice of the pool
+// sized by its quota. Quotas go by priority: higher priorities are served first, emitters of equal priority share
+// what is left evenly, and nobody gets more than its maxParticles. Quotas are reserved, not lent: a quiet emitter
+// keeps its slice. update() runs the chunks of all emitters as one batch on the pool.
+// ============================================================================
+class ParticleSystem {
+  public:
+	explicit ParticleSystem(size_t capacity = 100000) : capacity(capacity) {}
+
+	ThreadPool *threadPool = nullptr; // shared by all emitters
+
+	// the pool is resliced on add, remove and setPriority (live particles move along, those past a smaller quota
+	// are dropped); frames in between never allocate
+	ParticleEmitter &add(const EmitterParams &params, int priority = 0) {
+		slots.push_back({std::make_unique<ParticleEmitter>(params, 0), priority});
+		slots.back().emitter->random = Philox(params.seed + serial++); // emitters of one system must not draw the same particles
+		rebalance();
+		return *slots.back().emitter;
+	}
+
+	void remove(const ParticleEmitter &e) {
+		std::erase_if(slots, [&](const Slot &s) { return s.emitter.get() == &e; });
+		rebalance();
+	}
+
+	void setPriority(const ParticleEmitter &e, int priority) {
+		for (auto &s : slots)
+			if (s.emitter.get() == &e) s.priority = priority;
+		rebalance();
+	}
+
+	size_t quota(const ParticleEmitter &e) const { return e.capacity; }
+	size_t emitterCount() const { return slots.size(); }
+	ParticleEmitter &emitter(size_t i) { return *slots[i].emitter; }
+
+	// step all emitters: emission and noise lattices per emitter, then every emitter's chunks in a single pass
+	void update(float dt, PhysicsEngine *physics = nullptr, float timeNow = 0.0f) {
+		if (dt <= 0.0f) return;
+		tasks.clear();
+		// the bodies are binned once, with the margin of the largest colliding particles
+		float margin = -1.0f;
+		for (auto &s : slots)
+			if (s.emitter->params.collideWithPhysics) margin = std::max(margin, s.emitter->collisionMargin());
+		if (physics && margin >= 0.0f) bodyGrid.build(physics->bodies, margin);
+		for (auto &s : slots) {
+			ParticleEmitter &e = *s.emitter;
+			e.threadPool = threadPool;
+			e.beginStep(dt, physics, timeNow, &bodyGrid);
+			for (size_t b = 0; b < e.n; b += ParticleEmitter::kChunk) tasks.push_back({&e, b});
+		}
+		parallelFor(threadPool, 0, tasks.size(), 1, [&](size_t tb, size_t te) {
+			for (size_t t = tb; t < te; t++) {
+				auto [e, b] = tasks[t];
+				e->stepChunk(b, std::min(b + ParticleEmitter::kChunk, e->n));
+			}
+		});
+		for (auto &s : slots) s.emitter->endStep();
 	}
 
-	// helper to set color/size over lifetime (call before render)
 	void applyMorphs() {
-		for (auto &pt : particles) {
-			if (!pt.alive()) continue;
-			float t = glm::clamp(pt.life / pt.lifetime, 0.0f, 1.0f);
-			pt.color = glm::mix(params.colorStart, params.colorEnd, t);
-			// pt.size = glm::mix(pt.size, params.sizeMin * 0.1f, t);
-			// curves or texture-based ramps can be made, but again you may call me lazy
+		for (auto &s : slots) {
+			s.emitter->threadPool = threadPool;
+			s.emitter->applyMorphs();
 		}
 	}
 
-	EmitterParams params;
-	void clear() { particles.clear(); }
-	size_t aliveCount() const { return particles.size(); }
+	// each emitter with depthSort is sorted on its own; particles of different emitters are not interleaved
+	void sortByDepth(const glm::mat4 &view) {
+		for (auto &s : slots)
+			if (s.emitter->params.depthSort) s.emitter->sortByDepth(view);
+	}
+
+	template <typename RenderCallback> void renderAll(RenderCallback renderCb) {
+		for (auto &s : slots) s.emitter->renderAll(renderCb);
+	}
+
+	// the emitters collide against the shared grid, so its cells are drawn once here
+	void debugDraw(DebugDraw &dd, bool velocities = false, bool cells = false) const {
+		for (auto &s : slots) s.emitter->debugDraw(dd, velocities);
+		if (cells) bodyGrid.debugDraw(dd, glm::vec4(0.2f, 0.8f, 1.0f, 0.3f));
+	}
+
+	void clear() {
+		for (auto &s : slots) s.emitter->clear();
+	}
+
+	size_t aliveCount() const {
+		size_t total = 0;
+		for (auto &s : slots) total += s.emitter->aliveCount();
+		return total;
+	}
 
   private:
-	std::vector<Particle> particles;
-	glm::mat4 worldTransform = glm::mat4(1.0f);
-	PerlinNoise perlin;
-	std::mt19937 rng;
-	float emitAccumulator = 0.0f;
+	struct Slot {
+		std::unique_ptr<ParticleEmitter> emitter;
+		int priority = 0;
+	};
+	std::vector<Slot> slots;
+	std::vector<float> pool;                                 // every emitter's columns, slice after slice
+	std::vector<std::pair<ParticleEmitter *, size_t>> tasks; // (emitter, first particle) per chunk (scratch)
+	BodyGrid bodyGrid;                                       // colliders shared by the emitters
+	size_t capacity = 0;                                     // particles over all emitters
+	uint64_t serial = 0;                                     // emitters added so far
+
+	// water-fill the capacity level by level, then move every emitter into its slice of a new pool
+	void rebalance() {
+		std::vector<size_t> order(slots.size()), want(slots.size()), quotas(slots.size());
+		std::iota(order.begin(), order.end(), size_t(0));
+		for (size_t i = 0; i < slots.size(); i++) want[i] = size_t(std::max(slots[i].emitter->params.maxParticles, 0));
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return slots[a].priority != slots[b].priority ? slots[a].priority > slots[b].priority : want[a] < want[b];
+		});
+		size_t remaining = capacity;
+		for (size_t lo = 0, hi; lo < order.size(); lo = hi) {
+			for (hi = lo; hi < order.size() && slots[order[hi]].priority == slots[order[lo]].priority;) hi++;
+			// smallest demands first, each takes at most an even share of what the level has left
+			for (size_t k = lo; k < hi; k++) {
+				quotas[order[k]] = std::min(want[order[k]], remaining / (hi - k));
+				remaining -= quotas[order[k]];
+			}
+		}
 
-	inline float randFloat(float a, float b) {
-		std::uniform_real_distribution<float> dist(a, b);
-		return dist(rng);
+		size_t floats = 0, chunks = 0;
+		for (size_t q : quotas) floats += ParticleEmitter::kColumns * simd::paddedSize(q), chunks += q / ParticleEmitter::kChunk + 1;
+		std::vector<float> next(floats, 0.0f);
+		float *at = next.data();
+		for (size_t i = 0; i < slots.size(); i++) {
+			slots[i].emitter->bind(at, quotas[i]);
+			at += ParticleEmitter::kColumns * simd::paddedSize(quotas[i]);
+		}
+		pool.swap(next); // the old slices are released only after every emitter moved out
+		tasks.reserve(chunks);
 	}
 };
 } // namespace oglprojs
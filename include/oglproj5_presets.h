@@ -22,6 +22,10 @@ struct EmitterConfigurator {
 		params.burstCount = count;
 		return *this;
 	}
+	EmitterConfigurator &withSeed(unsigned int seed) {
+		params.seed = seed;
+		return *this;
+	}
 
 	EmitterConfigurator &withLifetime(float minv, float maxv) {
 		params.lifetimeMin = minv;
@@ -69,6 +73,17 @@ struct EmitterConfigurator {
 		params.noiseSeed = seed;
 		return *this;
 	}
+	EmitterConfigurator &withNoiseOctaves(int octaves, float lacunarity = 2.0f, float gain = 0.5f) {
+		params.noiseOctaves = octaves;
+		params.noiseLacunarity = lacunarity;
+		params.noiseGain = gain;
+		return *this;
+	}
+	EmitterConfigurator &withNoiseGrid(bool on, float density = 8.0f) {
+		params.noiseGrid = on;
+		params.noiseGridDensity = density;
+		return *this;
+	}
 
 	EmitterConfigurator &withSpawnPoint() {
 		params.spawnShape = EmitterParams::POINT;
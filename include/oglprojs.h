@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstddef>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -164,6 +165,153 @@ class Mesh {
 		glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
 		glBindVertexArray(0);
 	}
+
+	// read count per-instance vec4 attributes from buffer, starting at location firstLocation (after position/normal)
+	void setInstanceAttributes(GLuint buffer, GLuint firstLocation, GLuint count, GLsizei stride) {
+		glBindVertexArray(vao);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		for (GLuint k = 0; k < count; k++) {
+			glVertexAttribPointer(firstLocation + k, 4, GL_FLOAT, GL_FALSE, stride, (void *)(k * 4 * sizeof(float)));
+			glEnableVertexAttribArray(firstLocation + k);
+			glVertexAttribDivisor(firstLocation + k, 1);
+		}
+		glBindVertexArray(0);
+	}
+
+	void drawInstanced(GLsizei instances) const {
+		glBindVertexArray(vao);
+		glDrawElementsInstanced(GL_TRIANGLES, GLsizei(indexCount), GL_UNSIGNED_INT, 0, instances);
+		glBindVertexArray(0);
+	}
+};
+
+// Immediate-mode debug batcher: collect lines/points during the frame, flush() uploads everything into one
+// streamed VBO and issues one draw per primitive type.
+class DebugDraw {
+	struct Vertex {
+		glm::vec3 pos;
+		glm::vec4 color;
+	};
+	std::vector<Vertex> lines, points;
+	std::unique_ptr<Shader> shader;
+	GLuint vao = 0, vbo = 0;
+	size_t capacity = 0; // vertices the VBO can hold
+
+	void createGL() {
+		const std::string vertexSrc = R"(
+            #version 330 core
+            layout(location = 0) in vec3 aPos;
+            layout(location = 1) in vec4 aColor;
+            uniform mat4 viewProj;
+            uniform float pointSize;
+            out vec4 Color;
+            void main() {
+                Color = aColor;
+                gl_PointSize = pointSize;
+                gl_Position = viewProj * vec4(aPos, 1.0);
+            }
+        )";
+		const std::string fragmentSrc = R"(
+            #version 330 core
+            in vec4 Color;
+            out vec4 FragColor;
+            void main() { FragColor = Color; }
+        )";
+		shader = std::make_unique<Shader>(vertexSrc, fragmentSrc);
+
+		glGenVertexArrays(1, &vao);
+		glGenBuffers(1, &vbo);
+		glBindVertexArray(vao);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, pos));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, color));
+		glEnableVertexAttribArray(1);
+		glBindVertexArray(0);
+	}
+
+  public:
+	bool enabled = true;
+	float pointSize = 4.0f;
+
+	DebugDraw() = default;
+	DebugDraw(const DebugDraw &) = delete;
+	DebugDraw &operator=(const DebugDraw &) = delete;
+
+	~DebugDraw() {
+		if (vao) glDeleteVertexArrays(1, &vao);
+		if (vbo) glDeleteBuffers(1, &vbo);
+	}
+
+	void line(const glm::vec3 &a, const glm::vec3 &b, const glm::vec4 &color = glm::vec4(1.0f)) {
+		if (!enabled) return;
+		lines.push_back({a, color});
+		lines.push_back({b, color});
+	}
+
+	void point(const glm::vec3 &p, const glm::vec4 &color = glm::vec4(1.0f)) {
+		if (enabled) points.push_back({p, color});
+	}
+
+	// ray from p along v (velocities, normals)
+	void arrow(const glm::vec3 &p, const glm::vec3 &v, const glm::vec4 &color = glm::vec4(1.0f)) { line(p, p + v, color); }
+
+	void box(const glm::vec3 &mn, const glm::vec3 &mx, const glm::vec4 &color = glm::vec4(1.0f)) {
+		if (!enabled) return;
+		glm::vec3 c[8];
+		for (int i = 0; i < 8; i++) c[i] = glm::vec3((i & 1) ? mx.x : mn.x, (i & 2) ? mx.y : mn.y, (i & 4) ? mx.z : mn.z);
+		static const int edges[12][2] = {{0, 1}, {2, 3}, {4, 5}, {6, 7}, {0, 2}, {1, 3}, {4, 6}, {5, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+		for (const auto &e : edges) line(c[e[0]], c[e[1]], color);
+	}
+
+	// circle in the plane with the given normal
+	void circle(const glm::vec3 &center, float radius, const glm::vec3 &normal = glm::vec3(0.0f, 1.0f, 0.0f),
+	            const glm::vec4 &color = glm::vec4(1.0f), int segments = 16) {
+		if (!enabled) return;
+		glm::vec3 n = glm::normalize(normal);
+		glm::vec3 t = glm::abs(n.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		glm::vec3 u = glm::normalize(glm::cross(n, t)) * radius;
+		glm::vec3 v = glm::cross(n, u);
+		glm::vec3 prev = center + u;
+		for (int i = 1; i <= segments; i++) {
+			float a = 2.0f * std::numbers::pi_v<float> * i / segments;
+			glm::vec3 cur = center + u * std::cos(a) + v * std::sin(a);
+			line(prev, cur, color);
+			prev = cur;
+		}
+	}
+
+	size_t lineCount() const { return lines.size() / 2; }
+	size_t pointCount() const { return points.size(); }
+	void clear() {
+		lines.clear();
+		points.clear();
+	}
+
+	// upload everything once and draw (one call for lines, one for points), then clear for next frame
+	void flush(const glm::mat4 &view, const glm::mat4 &projection) {
+		size_t count = lines.size() + points.size();
+		if (count == 0) return;
+		if (!shader) createGL();
+
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		if (count > capacity) capacity = std::max(count, capacity * 2);
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Vertex), nullptr, GL_STREAM_DRAW); // grow or orphan
+		glBufferSubData(GL_ARRAY_BUFFER, 0, lines.size() * sizeof(Vertex), lines.data());
+		glBufferSubData(GL_ARRAY_BUFFER, lines.size() * sizeof(Vertex), points.size() * sizeof(Vertex), points.data());
+
+		shader->use();
+		shader->setMat4("viewProj", projection * view);
+		shader->setFloat("pointSize", pointSize);
+		glEnable(GL_PROGRAM_POINT_SIZE);
+
+		glBindVertexArray(vao);
+		if (!lines.empty()) glDrawArrays(GL_LINES, 0, (GLsizei)lines.size());
+		if (!points.empty()) glDrawArrays(GL_POINTS, (GLint)lines.size(), (GLsizei)points.size());
+		glBindVertexArray(0);
+
+		clear();
+	}
 };
 
 class GeometryFactory {
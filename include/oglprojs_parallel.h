@@ -0,0 +1,253 @@
+#ifndef OGLPROJS_PARALLEL_H
+#define OGLPROJS_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "oglprojs_simd.h" // intrinsics headers and OGLPROJS_SIMD_SSE2
+
+namespace oglprojs {
+
+// ============================================================================
+// ThreadPool: fixed workers that help the calling thread run parallelFor() chunks.
+// Chunks write disjoint outputs, so results do not depend on which thread ran which chunk.
+// ============================================================================
+
+class ThreadPool {
+	std::vector<std::thread> workers;
+	std::mutex m;
+	std::condition_variable wake, done;
+
+	std::function<void(size_t, size_t)> job;
+	size_t jobEnd = 0, jobGrain = 1;
+	std::atomic<size_t> next{0};
+	unsigned busy = 0;       // workers still inside the current job
+	uint64_t generation = 0; // bumped per job so workers run each job once
+	bool stop = false;
+
+	void runChunks() {
+		for (;;) {
+			size_t b = next.fetch_add(jobGrain);
+			if (b >= jobEnd) break;
+			job(b, std::min(b + jobGrain, jobEnd));
+		}
+	}
+
+	void workerLoop() {
+		uint64_t seen = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(m);
+				wake.wait(lock, [&] { return stop || generation != seen; });
+				if (stop) return;
+				seen = generation;
+			}
+			runChunks();
+			std::lock_guard<std::mutex> lock(m);
+			if (--busy == 0) done.notify_one();
+		}
+	}
+
+  public:
+	// threads = total threads including the caller (0 = hardware concurrency)
+	explicit ThreadPool(unsigned threads = 0) {
+		if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+		for (unsigned i = 1; i < threads; i++) workers.emplace_back([this] { workerLoop(); });
+	}
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(m);
+			stop = true;
+		}
+		wake.notify_all();
+		for (auto &w : workers) w.join();
+	}
+
+	unsigned size() const { return unsigned(workers.size()) + 1; }
+
+	// fn(chunkBegin, chunkEnd) over [begin, end) in chunks of grain; returns when all chunks are done
+	template <typename Fn> void parallelFor(size_t begin, size_t end, size_t grain, Fn fn) {
+		if (begin >= end) return;
+		grain = std::max<size_t>(grain, 1);
+		if (workers.empty() || end - begin <= grain) {
+			for (size_t b = begin; b < end; b += grain) fn(b, std::min(b + grain, end));
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m);
+			job = fn;
+			jobEnd = end;
+			jobGrain = grain;
+			next.store(begin);
+			busy = unsigned(workers.size());
+			generation++;
+		}
+		wake.notify_all();
+		runChunks();
+		std::unique_lock<std::mutex> lock(m);
+		done.wait(lock, [&] { return busy == 0; });
+		job = nullptr;
+	}
+};
+
+// run on the pool when there is one, inline otherwise
+template <typename Fn> inline void parallelFor(ThreadPool *pool, size_t begin, size_t end, size_t grain, Fn fn) {
+	if (pool) pool->parallelFor(begin, end, grain, fn);
+	else
+		for (size_t b = begin; b < end; b += std::max<size_t>(grain, 1)) fn(b, std::min(b + std::max<size_t>(grain, 1), end));
+}
+
+// ============================================================================
+// RandomStream: counter-based generator. Every draw is a pure function of (key, counter),
+// so a stream keyed by e.g. (seed, index, frame) gives the same numbers on any thread.
+// ============================================================================
+
+struct RandomStream {
+	uint64_t key = 0;
+
+	// SplitMix64 finalizer
+	static uint64_t mix(uint64_t z) {
+		z += 0x9E3779B97F4A7C15ull;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	RandomStream() = default;
+	RandomStream(uint64_t seed, uint64_t a, uint64_t b = 0) : key(mix(mix(mix(seed) ^ a) ^ b)) {}
+
+	uint64_t bits(uint64_t counter) const { return mix(key ^ (counter * 0xD1B54A32D192ED03ull)); }
+	// uniform in [0, 1) with 24 bits of precision
+	float uniform(uint64_t counter) const { return float(bits(counter) >> 40) * (1.0f / 16777216.0f); }
+	float uniform(uint64_t counter, float a, float b) const { return a + (b - a) * uniform(counter); }
+};
+
+// ============================================================================
+// Philox: Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"). A block of four 32-bit
+// words is a pure function of (key, 128-bit counter); the counter holds a 64-bit stream id and a 64-bit block
+// index, so every (seed, stream) pair is an independent sequence that any thread can read at any position.
+// Number j of a stream is word (j / 8) % 4 of block (j / 32) * 8 + j % 8: a run of 32 numbers is 8 blocks computed
+// side by side, which is what fill() does with AVX2 or SSE2.
+// ============================================================================
+
+struct Philox {
+	uint32_t key[2] = {0, 0};
+
+	Philox() = default;
+	explicit Philox(uint64_t seed) : key{uint32_t(seed), uint32_t(seed >> 32)} {}
+
+	static constexpr uint32_t kMul0 = 0xD2511F53u, kMul1 = 0xCD9E8D57u; // round multipliers
+	static constexpr uint32_t kWeyl0 = 0x9E3779B9u, kWeyl1 = 0xBB67AE85u; // key schedule increments
+
+	// the four words of block at counter (block index, stream)
+	void block(uint64_t index, uint64_t stream, uint32_t out[4]) const {
+		uint32_t c0 = uint32_t(index), c1 = uint32_t(index >> 32), c2 = uint32_t(stream), c3 = uint32_t(stream >> 32);
+		uint32_t k0 = key[0], k1 = key[1];
+		for (int r = 0; r < 10; r++, k0 += kWeyl0, k1 += kWeyl1) {
+			uint64_t p0 = uint64_t(kMul0) * c0, p1 = uint64_t(kMul1) * c2;
+			c0 = uint32_t(p1 >> 32) ^ c1 ^ k0, c1 = uint32_t(p1);
+			c2 = uint32_t(p0 >> 32) ^ c3 ^ k1, c3 = uint32_t(p0);
+		}
+		out[0] = c0, out[1] = c1, out[2] = c2, out[3] = c3;
+	}
+
+	uint32_t bits(uint64_t stream, uint64_t j) const {
+		uint32_t w[4];
+		block((j >> 5) * 8 + (j & 7), stream, w);
+		return w[(j >> 3) & 3];
+	}
+
+	// uniform in [0, 1) with 24 bits of precision
+	static float toUnit(uint32_t w) { return float(w >> 8) * (1.0f / 16777216.0f); }
+	float uniform(uint64_t stream, uint64_t j) const { return toUnit(bits(stream, j)); }
+	float uniform(uint64_t stream, uint64_t j, float a, float b) const { return a + (b - a) * uniform(stream, j); }
+
+	// numbers [first, first + count) of a stream as uniforms in [a, b)
+	void fill(uint64_t stream, uint64_t first, float *out, size_t count, float a, float b) const {
+		alignas(32) float run[32];
+		for (uint64_t j = first, end = first + count; j < end;) {
+			uint64_t group = j >> 5, at = j & 31, n = std::min<uint64_t>(32 - at, end - j);
+			float *dst = at == 0 && n == 32 ? out + (j - first) : run; // whole runs go straight to out
+			fillRun(stream, group, dst, a, b);
+			if (dst == run) std::copy_n(run + at, n, out + (j - first));
+			j += n;
+		}
+	}
+
+  private:
+	// the 32 numbers of run group: 8 blocks, word w of block k is number 8 w + k
+	void fillRun(uint64_t stream, uint64_t group, float *out, float a, float b) const {
+#if defined(__AVX2__)
+		const __m256i m0 = _mm256_set1_epi32(int(kMul0)), m1 = _mm256_set1_epi32(int(kMul1));
+		uint64_t index = group * 8;
+		__m256i c0 = _mm256_add_epi32(_mm256_set1_epi32(int(uint32_t(index))), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		__m256i c1 = _mm256_set1_epi32(int(uint32_t(index >> 32))); // index is a multiple of 8, the low word never carries
+		__m256i c2 = _mm256_set1_epi32(int(uint32_t(stream))), c3 = _mm256_set1_epi32(int(uint32_t(stream >> 32)));
+		uint32_t k0 = key[0], k1 = key[1];
+		// 32x32 -> 64 products of all 8 lanes: even lanes from one multiply, odd lanes from another
+		auto mulhilo = [](__m256i x, __m256i m, __m256i &hi, __m256i &lo) {
+			__m256i even = _mm256_mul_epu32(x, m), odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), m);
+			hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+			lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+		};
+		for (int r = 0; r < 10; r++, k0 += kWeyl0, k1 += kWeyl1) {
+			__m256i hi0, lo0, hi1, lo1;
+			mulhilo(c0, m0, hi0, lo0), mulhilo(c2, m1, hi1, lo1);
+			c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32(int(k0))), c1 = lo1;
+			c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32(int(k1))), c3 = lo0;
+		}
+		const __m256 scale = _mm256_set1_ps(1.0f / 16777216.0f), va = _mm256_set1_ps(a), range = _mm256_set1_ps(b - a);
+		__m256i words[4] = {c0, c1, c2, c3};
+		for (int w = 0; w < 4; w++) {
+			__m256 u = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(words[w], 8)), scale);
+			_mm256_storeu_ps(out + 8 * w, _mm256_add_ps(va, _mm256_mul_ps(range, u)));
+		}
+#elif defined(OGLPROJS_SIMD_SSE2)
+		// two halves of 4 blocks; SSE2 has no blend, the products are regrouped with shuffles and unpacks
+		const __m128i m0 = _mm_set1_epi32(int(kMul0)), m1 = _mm_set1_epi32(int(kMul1));
+		auto mulhilo = [](__m128i x, __m128i m, __m128i &hi, __m128i &lo) {
+			__m128i even = _mm_shuffle_epi32(_mm_mul_epu32(x, m), _MM_SHUFFLE(3, 1, 2, 0));                   // lo0 lo2 hi0 hi2
+			__m128i odd = _mm_shuffle_epi32(_mm_mul_epu32(_mm_srli_epi64(x, 32), m), _MM_SHUFFLE(3, 1, 2, 0)); // lo1 lo3 hi1 hi3
+			lo = _mm_unpacklo_epi32(even, odd), hi = _mm_unpackhi_epi32(even, odd);
+		};
+		const __m128 scale = _mm_set1_ps(1.0f / 16777216.0f), va = _mm_set1_ps(a), range = _mm_set1_ps(b - a);
+		for (int h = 0; h < 2; h++) {
+			uint64_t index = group * 8 + 4 * h;
+			__m128i c0 = _mm_add_epi32(_mm_set1_epi32(int(uint32_t(index))), _mm_setr_epi32(0, 1, 2, 3));
+			__m128i c1 = _mm_set1_epi32(int(uint32_t(index >> 32)));
+			__m128i c2 = _mm_set1_epi32(int(uint32_t(stream))), c3 = _mm_set1_epi32(int(uint32_t(stream >> 32)));
+			uint32_t k0 = key[0], k1 = key[1];
+			for (int r = 0; r < 10; r++, k0 += kWeyl0, k1 += kWeyl1) {
+				__m128i hi0, lo0, hi1, lo1;
+				mulhilo(c0, m0, hi0, lo0), mulhilo(c2, m1, hi1, lo1);
+				c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32(int(k0))), c1 = lo1;
+				c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32(int(k1))), c3 = lo0;
+			}
+			__m128i words[4] = {c0, c1, c2, c3};
+			for (int w = 0; w < 4; w++) {
+				__m128 u = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(words[w], 8)), scale);
+				_mm_storeu_ps(out + 8 * w + 4 * h, _mm_add_ps(va, _mm_mul_ps(range, u)));
+			}
+		}
+#else
+		for (int k = 0; k < 8; k++) {
+			uint32_t w[4];
+			block(group * 8 + k, stream, w);
+			for (int i = 0; i < 4; i++) out[8 * i + k] = a + (b - a) * toUnit(w[i]);
+		}
+#endif
+	}
+};
+
+} // namespace oglprojs
+#endif // OGLPROJS_PARALLEL_H
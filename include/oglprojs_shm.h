@@ -0,0 +1,111 @@
+#ifndef OGLPROJS_SHM_H
+#define OGLPROJS_SHM_H
+
+// POSIX shared memory for multi-process runs on one Linux machine; nothing is defined on other platforms
+#if defined(__linux__)
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace oglprojs {
+
+// ============================================================================
+// SharedMemory: a POSIX shm segment mapped read/write. The name is unlinked right after mapping, so the segment
+// lives exactly as long as its mappings: this process and the children forked after map().
+// ============================================================================
+
+class SharedMemory {
+	void *ptr = nullptr;
+	size_t bytes = 0;
+
+  public:
+	SharedMemory() = default;
+	SharedMemory(const SharedMemory &) = delete;
+	SharedMemory &operator=(const SharedMemory &) = delete;
+	~SharedMemory() { unmap(); }
+
+	// zero-filled segment of size bytes; false when the segment could not be created
+	bool map(size_t size) {
+		unmap();
+		static std::atomic<unsigned> serial{0};
+		std::string name = "/oglprojs-" + std::to_string(getpid()) + "-" + std::to_string(serial++);
+		int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0) return false;
+		shm_unlink(name.c_str());
+		void *p = ftruncate(fd, off_t(size)) == 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+		close(fd);
+		if (p == MAP_FAILED) return false;
+		ptr = p;
+		bytes = size;
+		return true;
+	}
+
+	void unmap() {
+		if (ptr) munmap(ptr, bytes);
+		ptr = nullptr;
+		bytes = 0;
+	}
+
+	void *data() const { return ptr; }
+	size_t size() const { return bytes; }
+};
+
+// ============================================================================
+// ShmRing: single-producer single-consumer byte ring placed in shared memory. head and tail count bytes written and
+// read since creation. writeSome/readSome never block, so two processes streaming to each other can alternate them
+// until both messages are through, whatever the message sizes.
+// ============================================================================
+
+struct ShmRing {
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring counters must be lock-free to be shared between processes");
+
+	alignas(64) std::atomic<uint64_t> head{0}; // written by the producer
+	alignas(64) std::atomic<uint64_t> tail{0}; // written by the consumer
+	alignas(64) uint64_t capacity = 0;         // data bytes following the header
+
+	// bytes needed at the placement address for a ring of capacity bytes (keeps the next ring cache-line aligned)
+	static size_t bytesFor(size_t capacity) { return (sizeof(ShmRing) + capacity + 63) & ~size_t(63); }
+
+	static ShmRing *create(void *at, size_t capacity) {
+		ShmRing *r = new (at) ShmRing;
+		r->capacity = capacity;
+		return r;
+	}
+
+	unsigned char *bytes() { return reinterpret_cast<unsigned char *>(this + 1); }
+
+	// copy up to n bytes in, returns the number written
+	size_t writeSome(const void *src, size_t n) {
+		uint64_t h = head.load(std::memory_order_relaxed), t = tail.load(std::memory_order_acquire);
+		n = std::min<size_t>(n, capacity - (h - t));
+		size_t at = size_t(h % capacity), first = std::min<size_t>(n, capacity - at);
+		std::memcpy(bytes() + at, src, first);
+		std::memcpy(bytes(), static_cast<const unsigned char *>(src) + first, n - first);
+		head.store(h + n, std::memory_order_release);
+		return n;
+	}
+
+	// copy up to n bytes out, returns the number read
+	size_t readSome(void *dst, size_t n) {
+		uint64_t t = tail.load(std::memory_order_relaxed), h = head.load(std::memory_order_acquire);
+		n = std::min<size_t>(n, h - t);
+		size_t at = size_t(t % capacity), first = std::min<size_t>(n, capacity - at);
+		std::memcpy(dst, bytes() + at, first);
+		std::memcpy(static_cast<unsigned char *>(dst) + first, bytes(), n - first);
+		tail.store(t + n, std::memory_order_release);
+		return n;
+	}
+};
+
+} // namespace oglprojs
+
+#endif // __linux__
+#endif // OGLPROJS_SHM_H
@@ -0,0 +1,249 @@
+#ifndef OGLPROJS_SIMD_H
+#define OGLPROJS_SIMD_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OGLPROJS_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace oglprojs::simd {
+
+// ============================================================================
+// f8: 8 float lanes. AVX when the compiler targets it, two SSE2 halves on any other x86-64 build,
+// plain lane loops elsewhere. Masks are f8 with all bits set per lane.
+// ============================================================================
+
+#if defined(__AVX__)
+struct f8 {
+	__m256 v;
+
+	f8() = default;
+	f8(__m256 x) : v(x) {}
+	f8(float s) : v(_mm256_set1_ps(s)) {}
+
+	static f8 load(const float *p) { return _mm256_loadu_ps(p); }
+	void store(float *p) const { _mm256_storeu_ps(p, v); }
+	static f8 iota() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+
+	friend f8 operator+(f8 a, f8 b) { return _mm256_add_ps(a.v, b.v); }
+	friend f8 operator-(f8 a, f8 b) { return _mm256_sub_ps(a.v, b.v); }
+	friend f8 operator*(f8 a, f8 b) { return _mm256_mul_ps(a.v, b.v); }
+	friend f8 operator/(f8 a, f8 b) { return _mm256_div_ps(a.v, b.v); }
+	friend f8 operator-(f8 a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+	f8 &operator+=(f8 b) { return *this = *this + b; }
+	f8 &operator-=(f8 b) { return *this = *this - b; }
+	f8 &operator*=(f8 b) { return *this = *this * b; }
+
+	friend f8 operator<(f8 a, f8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+	friend f8 operator>(f8 a, f8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+	friend f8 operator<=(f8 a, f8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+	friend f8 operator>=(f8 a, f8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+	friend f8 operator==(f8 a, f8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+	friend f8 operator!=(f8 a, f8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ); }
+	friend f8 operator&(f8 a, f8 b) { return _mm256_and_ps(a.v, b.v); }
+	friend f8 operator|(f8 a, f8 b) { return _mm256_or_ps(a.v, b.v); }
+};
+
+inline f8 min(f8 a, f8 b) { return _mm256_min_ps(a.v, b.v); }
+inline f8 max(f8 a, f8 b) { return _mm256_max_ps(a.v, b.v); }
+inline f8 sqrt(f8 a) { return _mm256_sqrt_ps(a.v); }
+inline f8 floor(f8 a) { return _mm256_floor_ps(a.v); }
+// mask ? a : b
+inline f8 select(f8 mask, f8 a, f8 b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+inline bool any(f8 mask) { return _mm256_movemask_ps(mask.v) != 0; }
+// bit l set when lane l of mask is set
+inline unsigned bitmask(f8 mask) { return unsigned(_mm256_movemask_ps(mask.v)); }
+inline float hsum(f8 a) {
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+}
+#elif defined(OGLPROJS_SIMD_SSE2)
+struct f8 {
+	__m128 lo, hi;
+
+	f8() = default;
+	f8(__m128 l, __m128 h) : lo(l), hi(h) {}
+	f8(float s) : lo(_mm_set1_ps(s)), hi(_mm_set1_ps(s)) {}
+
+	static f8 load(const float *p) { return {_mm_loadu_ps(p), _mm_loadu_ps(p + 4)}; }
+	void store(float *p) const {
+		_mm_storeu_ps(p, lo);
+		_mm_storeu_ps(p + 4, hi);
+	}
+	static f8 iota() { return {_mm_setr_ps(0, 1, 2, 3), _mm_setr_ps(4, 5, 6, 7)}; }
+
+	friend f8 operator+(f8 a, f8 b) { return {_mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi)}; }
+	friend f8 operator-(f8 a, f8 b) { return {_mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi)}; }
+	friend f8 operator*(f8 a, f8 b) { return {_mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi)}; }
+	friend f8 operator/(f8 a, f8 b) { return {_mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi)}; }
+	friend f8 operator-(f8 a) { return f8(-0.0f) ^ a; }
+	f8 &operator+=(f8 b) { return *this = *this + b; }
+	f8 &operator-=(f8 b) { return *this = *this - b; }
+	f8 &operator*=(f8 b) { return *this = *this * b; }
+
+	friend f8 operator<(f8 a, f8 b) { return {_mm_cmplt_ps(a.lo, b.lo), _mm_cmplt_ps(a.hi, b.hi)}; }
+	friend f8 operator>(f8 a, f8 b) { return {_mm_cmpgt_ps(a.lo, b.lo), _mm_cmpgt_ps(a.hi, b.hi)}; }
+	friend f8 operator<=(f8 a, f8 b) { return {_mm_cmple_ps(a.lo, b.lo), _mm_cmple_ps(a.hi, b.hi)}; }
+	friend f8 operator>=(f8 a, f8 b) { return {_mm_cmpge_ps(a.lo, b.lo), _mm_cmpge_ps(a.hi, b.hi)}; }
+	friend f8 operator==(f8 a, f8 b) { return {_mm_cmpeq_ps(a.lo, b.lo), _mm_cmpeq_ps(a.hi, b.hi)}; }
+	friend f8 operator!=(f8 a, f8 b) { return {_mm_cmpneq_ps(a.lo, b.lo), _mm_cmpneq_ps(a.hi, b.hi)}; }
+	friend f8 operator&(f8 a, f8 b) { return {_mm_and_ps(a.lo, b.lo), _mm_and_ps(a.hi, b.hi)}; }
+	friend f8 operator|(f8 a, f8 b) { return {_mm_or_ps(a.lo, b.lo), _mm_or_ps(a.hi, b.hi)}; }
+	friend f8 operator^(f8 a, f8 b) { return {_mm_xor_ps(a.lo, b.lo), _mm_xor_ps(a.hi, b.hi)}; }
+};
+
+inline f8 min(f8 a, f8 b) { return {_mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi)}; }
+inline f8 max(f8 a, f8 b) { return {_mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi)}; }
+inline f8 sqrt(f8 a) { return {_mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi)}; }
+inline f8 floor(f8 a) {
+	// truncate, then step down where truncation rounded up (negative non-integers); valid for |x| < 2^31
+	auto fl = [](__m128 x) {
+		__m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+		return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+	};
+	return {fl(a.lo), fl(a.hi)};
+}
+inline f8 select(f8 mask, f8 a, f8 b) {
+	return {_mm_or_ps(_mm_and_ps(mask.lo, a.lo), _mm_andnot_ps(mask.lo, b.lo)),
+	        _mm_or_ps(_mm_and_ps(mask.hi, a.hi), _mm_andnot_ps(mask.hi, b.hi))};
+}
+inline bool any(f8 mask) { return (_mm_movemask_ps(mask.lo) | _mm_movemask_ps(mask.hi)) != 0; }
+inline unsigned bitmask(f8 mask) { return unsigned(_mm_movemask_ps(mask.lo) | (_mm_movemask_ps(mask.hi) << 4)); }
+inline float hsum(f8 a) {
+	__m128 s = _mm_add_ps(a.lo, a.hi);
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+}
+#else
+struct f8 {
+	float v[8];
+
+	f8() = default;
+	f8(float s) {
+		for (int i = 0; i < 8; i++) v[i] = s;
+	}
+
+	static f8 load(const float *p) {
+		f8 r;
+		for (int i = 0; i < 8; i++) r.v[i] = p[i];
+		return r;
+	}
+	void store(float *p) const {
+		for (int i = 0; i < 8; i++) p[i] = v[i];
+	}
+	static f8 iota() {
+		f8 r;
+		for (int i = 0; i < 8; i++) r.v[i] = float(i);
+		return r;
+	}
+
+	template <typename Op> static f8 map(f8 a, f8 b, Op op) {
+		f8 r;
+		for (int i = 0; i < 8; i++) r.v[i] = op(a.v[i], b.v[i]);
+		return r;
+	}
+	template <typename Op> static f8 mask(f8 a, f8 b, Op op) {
+		f8 r;
+		for (int i = 0; i < 8; i++) r.v[i] = op(a.v[i], b.v[i]) ? allOnes() : 0.0f;
+		return r;
+	}
+	static float allOnes() {
+		unsigned u = 0xFFFFFFFFu;
+		float f;
+		std::memcpy(&f, &u, sizeof(f));
+		return f;
+	}
+	static unsigned bits(float f) {
+		unsigned u;
+		std::memcpy(&u, &f, sizeof(u));
+		return u;
+	}
+	static float fromBits(unsigned u) {
+		float f;
+		std::memcpy(&f, &u, sizeof(f));
+		return f;
+	}
+
+	friend f8 operator+(f8 a, f8 b) { return map(a, b, [](float x, float y) { return x + y; }); }
+	friend f8 operator-(f8 a, f8 b) { return map(a, b, [](float x, float y) { return x - y; }); }
+	friend f8 operator*(f8 a, f8 b) { return map(a, b, [](float x, float y) { return x * y; }); }
+	friend f8 operator/(f8 a, f8 b) { return map(a, b, [](float x, float y) { return x / y; }); }
+	friend f8 operator-(f8 a) { return map(a, a, [](float x, float) { return -x; }); }
+	f8 &operator+=(f8 b) { return *this = *this + b; }
+	f8 &operator-=(f8 b) { return *this = *this - b; }
+	f8 &operator*=(f8 b) { return *this = *this * b; }
+
+	friend f8 operator<(f8 a, f8 b) { return mask(a, b, [](float x, float y) { return x < y; }); }
+	friend f8 operator>(f8 a, f8 b) { return mask(a, b, [](float x, float y) { return x > y; }); }
+	friend f8 operator<=(f8 a, f8 b) { return mask(a, b, [](float x, float y) { return x <= y; }); }
+	friend f8 operator>=(f8 a, f8 b) { return mask(a, b, [](float x, float y) { return x >= y; }); }
+	friend f8 operator==(f8 a, f8 b) { return mask(a, b, [](float x, float y) { return x == y; }); }
+	friend f8 operator!=(f8 a, f8 b) { return mask(a, b, [](float x, float y) { return x != y; }); }
+	friend f8 operator&(f8 a, f8 b) { return map(a, b, [](float x, float y) { return fromBits(bits(x) & bits(y)); }); }
+	friend f8 operator|(f8 a, f8 b) { return map(a, b, [](float x, float y) { return fromBits(bits(x) | bits(y)); }); }
+};
+
+inline f8 min(f8 a, f8 b) { return f8::map(a, b, [](float x, float y) { return y < x ? y : x; }); }
+inline f8 max(f8 a, f8 b) { return f8::map(a, b, [](float x, float y) { return x < y ? y : x; }); }
+inline f8 sqrt(f8 a) { return f8::map(a, a, [](float x, float) { return std::sqrt(x); }); }
+inline f8 floor(f8 a) { return f8::map(a, a, [](float x, float) { return std::floor(x); }); }
+inline f8 select(f8 mask, f8 a, f8 b) {
+	f8 r;
+	for (int i = 0; i < 8; i++) r.v[i] = f8::bits(mask.v[i]) ? a.v[i] : b.v[i];
+	return r;
+}
+inline bool any(f8 mask) {
+	for (int i = 0; i < 8; i++)
+		if (f8::bits(mask.v[i])) return true;
+	return false;
+}
+inline unsigned bitmask(f8 mask) {
+	unsigned m = 0;
+	for (int i = 0; i < 8; i++)
+		if (f8::bits(mask.v[i])) m |= 1u << i;
+	return m;
+}
+inline float hsum(f8 a) {
+	return ((a.v[0] + a.v[4]) + (a.v[2] + a.v[6])) + ((a.v[1] + a.v[5]) + (a.v[3] + a.v[7]));
+}
+#endif
+
+// 8 vec3 lanes in SoA form
+struct v3x8 {
+	f8 x, y, z;
+
+	v3x8() = default;
+	v3x8(f8 x, f8 y, f8 z) : x(x), y(y), z(z) {}
+
+	static v3x8 load(const float *px, const float *py, const float *pz) { return {f8::load(px), f8::load(py), f8::load(pz)}; }
+	void store(float *px, float *py, float *pz) const {
+		x.store(px);
+		y.store(py);
+		z.store(pz);
+	}
+
+	friend v3x8 operator+(const v3x8 &a, const v3x8 &b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+	friend v3x8 operator-(const v3x8 &a, const v3x8 &b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+	friend v3x8 operator*(const v3x8 &a, f8 s) { return {a.x * s, a.y * s, a.z * s}; }
+	friend v3x8 operator*(f8 s, const v3x8 &a) { return {a.x * s, a.y * s, a.z * s}; }
+	v3x8 &operator+=(const v3x8 &b) { return *this = *this + b; }
+	v3x8 &operator-=(const v3x8 &b) { return *this = *this - b; }
+};
+
+inline f8 dot(const v3x8 &a, const v3x8 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline v3x8 select(f8 mask, const v3x8 &a, const v3x8 &b) { return {select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z)}; }
+
+// pad a column length so 8-wide loads starting at any valid index stay in bounds
+inline size_t paddedSize(size_t n) { return ((n + 7) & ~size_t(7)) + 8; }
+
+} // namespace oglprojs::simd
+#endif // OGLPROJS_SIMD_H
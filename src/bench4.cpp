@@ -0,0 +1,291 @@
+#include "oglproj4.h"
+#include "oglproj4_slabs.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace oglprojs;
+
+// ============================================================================
+// bench4 - headless Flock::update benchmark (no window, no GL calls)
+// ============================================================================
+
+struct BenchConfig {
+	std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+	std::vector<Flock::NeighborSearch> modes = {Flock::NeighborSearch::Grid, Flock::NeighborSearch::Topological,
+	                                            Flock::NeighborSearch::BarnesHut, Flock::NeighborSearch::Verlet,
+	                                            Flock::NeighborSearch::BruteForce};
+	int updates = 10;
+	int warmup = 2;
+	unsigned threads = 0;         // 0 = hardware concurrency, 1 = no pool
+	unsigned seed = 12345;        // boid placement and obstacles
+	float density = 4.0f;         // boids per cubic unit, so neighbor counts stay comparable across sizes
+	size_t bruteForceMax = 20000; // BruteForce is O(N^2): skipped above this size
+	bool obstacles = true;        // also run every case with a PhysicsEngine obstacle set
+	std::vector<int> slabs;       // also run Grid split over this many processes (SlabFlock, Linux only)
+	std::string jsonPath;         // empty = JSON to stdout after the table
+};
+
+struct BenchResult {
+	size_t boids;
+	std::string mode;
+	bool obstacles;
+	double msPerUpdate, avgNeighbors;
+	size_t memoryBytes;
+	size_t rebuilds; // Verlet list rebuilds during the timed updates
+};
+
+static const char *modeName(Flock::NeighborSearch m) {
+	switch (m) {
+	case Flock::NeighborSearch::BruteForce: return "bruteforce";
+	case Flock::NeighborSearch::Grid: return "grid";
+	case Flock::NeighborSearch::Topological: return "topological";
+	case Flock::NeighborSearch::BarnesHut: return "barneshut";
+	case Flock::NeighborSearch::Verlet: return "verlet";
+	}
+	return "?";
+}
+
+// spheres and capsules spread through the flock volume (static, the engine is never stepped)
+static void createObstacles(PhysicsEngine &physics, float halfExtent, unsigned seed) {
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> uni(-1.0f, 1.0f);
+	for (int i = 0; i < 24; i++) {
+		RigidBody b;
+		b.radius = 0.3f + 0.4f * (uni(rng) + 1.0f);
+		b.position = glm::vec3(uni(rng), uni(rng), uni(rng)) * halfExtent;
+		b.invMass = 0.0f;
+		b.invInertia = 0.0f;
+		physics.addBody(b);
+	}
+	for (int i = 0; i < 6; i++) {
+		glm::vec3 a = glm::vec3(uni(rng), uni(rng), uni(rng)) * halfExtent;
+		physics.addKinematicCapsule(a, a + glm::vec3(uni(rng), uni(rng), uni(rng)), 0.25f);
+	}
+}
+
+// seeded flock of n boids in a cube of side L at the configured density, confined a little outside it
+static void createFlock(const BenchConfig &cfg, size_t n, Flock &flock) {
+	float halfExtent = 0.5f * std::cbrt(float(n) / cfg.density);
+	flock.resize(n);
+	std::mt19937 rng(cfg.seed);
+	std::uniform_real_distribution<float> uni(-1.0f, 1.0f);
+	for (size_t i = 0; i < n; i++) {
+		Boid b;
+		b.position = glm::vec3(uni(rng), uni(rng), uni(rng)) * halfExtent;
+		b.velocity = glm::normalize(glm::vec3(uni(rng), uni(rng) * 0.2f, uni(rng)) + glm::vec3(0.0f, 0.0f, 1e-3f)) * 1.5f;
+		b.maxSpeed = 2.0f + (uni(rng) + 1.0f);
+		b.maxForce = 4.0f;
+		flock.setBoid(i, b);
+	}
+	// same tuning as Application::createFlock
+	flock.neighborRadius = 0.9f;
+	flock.separationRadius = 0.28f;
+	flock.wSeparation = 1.8f;
+	flock.wAlignment = 1.0f;
+	flock.wCohesion = 0.9f;
+	flock.wWander = 0.15f;
+	flock.wAvoid = 2.5f;
+	flock.worldRadius = halfExtent * 1.2f;
+}
+
+// the pool lives for one case only, so the process is single-threaded again when a SlabFlock forks
+static BenchResult runCase(const BenchConfig &cfg, size_t n, Flock::NeighborSearch mode, bool obstacles, unsigned threads) {
+	float halfExtent = 0.5f * std::cbrt(float(n) / cfg.density);
+	ThreadPool pool(threads);
+	Flock flock(0, cfg.seed);
+	createFlock(cfg, n, flock);
+	flock.threadPool = pool.size() > 1 ? &pool : nullptr;
+	flock.neighborSearch = mode;
+
+	PhysicsEngine physics;
+	if (obstacles) createObstacles(physics, halfExtent, cfg.seed);
+	PhysicsEngine *pe = obstacles ? &physics : nullptr;
+
+	const float dt = 1.0f / 60.0f;
+	for (int k = 0; k < cfg.warmup; k++) flock.update(dt, pe);
+	size_t rebuilds = flock.verletRebuilds();
+	double neighbors = 0.0;
+	auto t0 = std::chrono::steady_clock::now();
+	for (int k = 0; k < cfg.updates; k++) {
+		flock.update(dt, pe);
+		neighbors += flock.averageNeighbors();
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(t1 - t0).count() / std::max(cfg.updates, 1);
+	return {n, modeName(mode), obstacles, ms, neighbors / std::max(cfg.updates, 1), flock.memoryBytes(),
+	        flock.verletRebuilds() - rebuilds};
+}
+
+#if defined(__linux__)
+// Grid mode split into slabs, one process each with threads / slabs threads
+static BenchResult runSlabCase(const BenchConfig &cfg, size_t n, int slabs, bool obstacles, unsigned threads) {
+	float halfExtent = 0.5f * std::cbrt(float(n) / cfg.density);
+	Flock flock(0, cfg.seed);
+	createFlock(cfg, n, flock);
+	PhysicsEngine physics;
+	if (obstacles) createObstacles(physics, halfExtent, cfg.seed);
+
+	BenchResult r{n, "grid/" + std::to_string(slabs) + "p", obstacles, 0.0, 0.0, 0, 0};
+	SlabFlock slabFlock;
+	slabFlock.threadsPerSlab = std::max(1u, threads / unsigned(slabs));
+	if (!slabFlock.start(flock, slabs, obstacles ? &physics : nullptr)) return r;
+	const float dt = 1.0f / 60.0f;
+	slabFlock.step(cfg.warmup, dt);
+	auto t0 = std::chrono::steady_clock::now();
+	bool ok = slabFlock.step(cfg.updates, dt);
+	auto t1 = std::chrono::steady_clock::now();
+	if (ok) r.msPerUpdate = std::chrono::duration<double, std::milli>(t1 - t0).count() / std::max(cfg.updates, 1);
+	return r;
+}
+#endif
+
+static std::string toJson(const BenchConfig &cfg, unsigned threads, const std::vector<BenchResult> &results) {
+	std::ostringstream out;
+	out << "{\n  \"threads\": " << threads << ",\n  \"updates\": " << cfg.updates << ",\n  \"seed\": " << cfg.seed
+	    << ",\n  \"density\": " << cfg.density << ",\n  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchResult &r = results[i];
+		out << "    {\"boids\": " << r.boids << ", \"mode\": \"" << r.mode << "\", \"obstacles\": " << (r.obstacles ? "true" : "false")
+		    << ", \"msPerUpdate\": " << r.msPerUpdate << ", \"avgNeighbors\": " << r.avgNeighbors << ", \"memoryBytes\": " << r.memoryBytes
+		    << ", \"rebuilds\": " << r.rebuilds << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+	return out.str();
+}
+
+static std::vector<std::string> splitList(const std::string &s) {
+	std::vector<std::string> items;
+	std::stringstream ss(s);
+	for (std::string item; std::getline(ss, item, ',');)
+		if (!item.empty()) items.push_back(item);
+	return items;
+}
+
+static void printUsage(const char *program) {
+	std::cout << "Usage: " << program << " [options]\n"
+	          << "Options:\n"
+	          << "  -sizes <n1,n2,...>       Flock sizes (default: 1000,10000,100000,1000000)\n"
+	          << "  -modes <m1,m2,...>       grid, topological, barneshut, verlet, bruteforce (default: all)\n"
+	          << "  -updates <N>             Timed updates per case (default: 10)\n"
+	          << "  -threads <N>             Threads including the caller, 0 = all cores (default: 0)\n"
+	          << "  -seed <number>           Seed for boid placement and obstacles (default: 12345)\n"
+	          << "  -density <d>             Boids per cubic unit (default: 4)\n"
+	          << "  -brutemax <N>            Largest flock run with bruteforce (default: 20000)\n"
+	          << "  -slabs <p1,p2,...>       Also run grid split over p processes, sharing the threads (Linux only)\n"
+	          << "  -noobstacles             Skip the runs with a PhysicsEngine obstacle set\n"
+	          << "  -json <file>             Write JSON results to file instead of stdout\n";
+}
+
+// whole-string number in the range of T: std::stoull alone would read "1k" as 1 and "-2" as a huge value
+template <typename T> static T parseNumber(const std::string &s) {
+	size_t used = 0;
+	T value;
+	if constexpr (std::is_floating_point_v<T>) {
+		value = T(std::stod(s, &used));
+	} else {
+		long long v = std::stoll(s, &used);
+		if (v < 0 && std::is_unsigned_v<T>) throw std::out_of_range(s);
+		if (std::is_signed_v<T> && v < (long long)std::numeric_limits<T>::min()) throw std::out_of_range(s);
+		if (v > 0 && (unsigned long long)v > (unsigned long long)std::numeric_limits<T>::max()) throw std::out_of_range(s);
+		value = T(v);
+	}
+	if (used != s.size()) throw std::invalid_argument(s);
+	return value;
+}
+
+static bool parseArgs(int argc, char **argv, BenchConfig &cfg) {
+	int i = 1;
+	try {
+		for (; i < argc; i++) {
+			std::string args = argv[i];
+			if (args == "-sizes" && i + 1 < argc) {
+				cfg.sizes.clear();
+				for (auto &v : splitList(argv[++i])) cfg.sizes.push_back(parseNumber<size_t>(v));
+			} else if (args == "-modes" && i + 1 < argc) {
+				cfg.modes.clear();
+				for (auto &v : splitList(argv[++i])) {
+					bool found = false;
+					for (auto m : {Flock::NeighborSearch::BruteForce, Flock::NeighborSearch::Grid, Flock::NeighborSearch::Topological,
+					               Flock::NeighborSearch::BarnesHut, Flock::NeighborSearch::Verlet})
+						if (v == modeName(m)) cfg.modes.push_back(m), found = true;
+					if (!found) {
+						std::cerr << "Unknown mode: " << v << std::endl;
+						return false;
+					}
+				}
+			} else if (args == "-updates" && i + 1 < argc) {
+				cfg.updates = parseNumber<int>(argv[++i]);
+			} else if (args == "-threads" && i + 1 < argc) {
+				cfg.threads = parseNumber<unsigned>(argv[++i]);
+			} else if (args == "-seed" && i + 1 < argc) {
+				cfg.seed = parseNumber<unsigned>(argv[++i]);
+			} else if (args == "-density" && i + 1 < argc) {
+				cfg.density = parseNumber<float>(argv[++i]);
+			} else if (args == "-brutemax" && i + 1 < argc) {
+				cfg.bruteForceMax = parseNumber<size_t>(argv[++i]);
+			} else if (args == "-slabs" && i + 1 < argc) {
+				for (auto &v : splitList(argv[++i])) cfg.slabs.push_back(parseNumber<int>(v));
+			} else if (args == "-noobstacles") {
+				cfg.obstacles = false;
+			} else if (args == "-json" && i + 1 < argc) {
+				cfg.jsonPath = argv[++i];
+			} else {
+				printUsage(argv[0]);
+				return false;
+			}
+		}
+	} catch (const std::exception &) {
+		// std::stoll / std::stoull / std::stod throw on text that is not a number or is out of range
+		std::cerr << "Invalid value for " << argv[i - 1] << ": " << argv[i] << std::endl;
+		printUsage(argv[0]);
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+	BenchConfig cfg;
+	if (!parseArgs(argc, argv, cfg)) return 1;
+
+	unsigned threads = cfg.threads > 0 ? cfg.threads : std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<BenchResult> results;
+	std::printf("%10s %-12s %-9s %12s %10s %12s\n", "boids", "mode", "obstacles", "ms/update", "neighbors", "memory (MB)");
+	auto print = [&](const BenchResult &r) {
+		std::printf("%10zu %-12s %-9s %12.3f %10.2f %12.2f\n", r.boids, r.mode.c_str(), r.obstacles ? "yes" : "no", r.msPerUpdate,
+		            r.avgNeighbors, double(r.memoryBytes) / (1024.0 * 1024.0));
+		std::fflush(stdout);
+		results.push_back(r);
+	};
+	for (size_t n : cfg.sizes) {
+		for (auto mode : cfg.modes) {
+			if (mode == Flock::NeighborSearch::BruteForce && n > cfg.bruteForceMax) continue;
+			for (bool obstacles : {false, true})
+				if (!obstacles || cfg.obstacles) print(runCase(cfg, n, mode, obstacles, threads));
+		}
+#if defined(__linux__)
+		// neighbors/memory are not collected from the slab processes
+		for (int p : cfg.slabs)
+			for (bool obstacles : {false, true})
+				if (!obstacles || cfg.obstacles) print(runSlabCase(cfg, n, p, obstacles, threads));
+#endif
+	}
+
+	std::string json = toJson(cfg, threads, results);
+	if (cfg.jsonPath.empty()) {
+		std::cout << json;
+	} else {
+		std::ofstream file(cfg.jsonPath);
+		if (!file) {
+			std::cerr << "Failed to open " << cfg.jsonPath << std::endl;
+			return 1;
+		}
+		file << json;
+	}
+	return 0;
+}
@@ -177,7 +177,8 @@ class Application {
 
 		// for proj4
 		if (flock && boidMesh && shader) {
-			for (const auto &b : flock->boids) {
+			for (size_t i = 0; i < flock->size(); ++i) {
+				const Boid b = flock->boid(i);
 				// orient boid to face velocity direction if velocity significant
 				glm::vec3 dir = b.velocity;
 				glm::mat4 orient = glm::mat4(1.0f);
@@ -30,19 +30,31 @@ class Application {
 	OrientationType orientType = OrientationType::Quaternion;
 	InterpType interpType = InterpType::CatmullRom;
 	std::unique_ptr<Shader> shader;
+	std::unique_ptr<Shader> instanceShader; // same lighting, model transform from per-instance position/quaternion/scale
 	std::shared_ptr<MotionController> motion;
 
 	std::vector<std::unique_ptr<Mesh>> boneMeshes;
 	std::unique_ptr<ArticulatedFigure> articulated;
+	glm::mat4 boneModels[5];
+	std::vector<size_t> boneColliders; // kinematic capsules in physics.bodies, one per bone
 
 	PhysicsEngine physics;
 	std::unique_ptr<Mesh> sphereMesh;
 
 	std::unique_ptr<Flock> flock;
 	std::unique_ptr<Mesh> boidMesh;
+	std::unique_ptr<FlowField> flowField; // optional baked avoidance/confinement for the flock
+	GLuint boidInstanceVbo = 0;           // streamed copy of flock->instances
 
 	std::unique_ptr<ParticleEmitter> particleEmitter;
-	std::unique_ptr<Mesh> particleMesh; // reuse sphere mesh
+	std::unique_ptr<Mesh> particleMesh;      // reuse sphere mesh
+	std::unique_ptr<ParticleSystem> torches; // many small emitters sharing one capped particle pool
+
+	DebugDraw debugDraw;
+	bool showDebug = false;
+	bool showCells = false; // broadphase cells of the flock grid and the particle collider grids
+
+	ThreadPool pool; // shared by the simulation systems
 
 	void createShader() {
 		const std::string vertexSrc = R"(
@@ -99,6 +111,45 @@ class Application {
         )";
 
 		shader = std::make_unique<Shader>(vertexSrc, fragmentSrc);
+
+		const std::string instanceVertexSrc = R"(
+            #version 330 core
+            layout(location = 0) in vec3 aPos;
+            layout(location = 1) in vec3 aNormal;
+            layout(location = 2) in vec4 iPositionScale;
+            layout(location = 3) in vec4 iRotation;
+            
+            uniform mat4 view;
+            uniform mat4 projection;
+            
+            out vec3 FragPos;
+            out vec3 Normal;
+            
+            vec3 rotate(vec4 q, vec3 v) { return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v); }
+            
+            void main() {
+                FragPos = iPositionScale.xyz + rotate(iRotation, aPos * iPositionScale.w);
+                Normal = rotate(iRotation, aNormal);
+                gl_Position = projection * view * vec4(FragPos, 1.0);
+            }
+        )";
+
+		instanceShader = std::make_unique<Shader>(instanceVertexSrc, fragmentSrc);
+		// lighting and material never change, so set them once here (same values as render())
+		Shader &is = *instanceShader;
+		is.CacheUniforms();
+		is.use();
+		is.set(is.U.uViewPos, glm::vec3(0.0f, 2.0f, 5.0f));
+		is.set(is.U.uLightPos, glm::vec3(5.0f, 5.0f, 5.0f));
+		is.set(is.U.uLightAmbient, glm::vec3(0.4f));
+		is.set(is.U.uLightDiffuse, glm::vec3(0.3f));
+		is.set(is.U.uLightSpecular, glm::vec3(0.4f));
+		is.set(is.U.uLightColor, glm::vec3(1.0f, 1.0f, 1.0f));
+		is.set(is.U.uMatAmbient, glm::vec3(0.11f, 0.06f, 0.11f));
+		is.set(is.U.uMatDiffuse, glm::vec3(0.43f, 0.47f, 0.54f));
+		is.set(is.U.uMatSpecular, glm::vec3(0.33f, 0.33f, 0.52f));
+		is.set(is.U.uMatEmission, glm::vec3(0.1f, 0, 0.1f));
+		is.set(is.U.uObjectColor, glm::vec4(0.8f, 0.5f, 0.3f, 1.0f));
 	}
 
 	void update() {
@@ -106,8 +157,10 @@ class Application {
 		time += motionSpeed;
 		if (time > loopTime) time = 0.0f;
 		float dt = 1.0f / float(FPS);
+		updateArticulated(dt);
 		physics.step(dt);
 
+		if (flowField) flowField->update(&physics); // rebakes around moved bodies only
 		if (flock) flock->update(dt, &physics);
 
 		if (particleEmitter) {
@@ -119,6 +172,50 @@ class Application {
 			particleEmitter->update(dt, particleEmitter->params.collideWithPhysics ? &physics : nullptr, time);
 			particleEmitter->applyMorphs();
 		}
+
+		if (torches) {
+			torches->update(dt, &physics, time);
+			torches->applyMorphs();
+		}
+	}
+
+	// evaluate bones once per frame and move their capsule proxies so physics, flock and particles collide with legs
+	void updateArticulated(float dt) {
+		if (!isArticulated || !articulated) {
+			if (!boneColliders.empty()) physics.removeBodies(boneColliders);
+			boneColliders.clear();
+			return;
+		}
+		articulated->evaluateBones(time, orientType, interpType, boneModels);
+
+		glm::vec3 a[5], b[5];
+		float r[5];
+		articulated->boneCapsules(boneModels, a, b, r);
+		if (boneColliders.empty()) {
+			for (int i = 0; i < 5; i++) boneColliders.push_back(physics.addKinematicCapsule(a[i], b[i], r[i]));
+		} else {
+			for (int i = 0; i < 5; i++) physics.moveKinematicCapsule(boneColliders[i], a[i], b[i], dt);
+		}
+	}
+
+	// stream the flock's packed instances and draw every boid with one call
+	void renderBoids(const glm::mat4 &view, const glm::mat4 &projection) {
+		const std::vector<BoidInstance> &instances = flock->instances;
+		if (!boidInstanceVbo) {
+			glGenBuffers(1, &boidInstanceVbo);
+			boidMesh->setInstanceAttributes(boidInstanceVbo, 2, 2, sizeof(BoidInstance));
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, boidInstanceVbo);
+		glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(BoidInstance), nullptr, GL_STREAM_DRAW); // orphan
+		glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(BoidInstance), instances.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		Shader &is = *instanceShader;
+		is.use();
+		is.set(is.U.uView, view);
+		is.set(is.U.uProj, projection);
+		boidMesh->drawInstanced(GLsizei(instances.size()));
+		shader->use();
 	}
 
 	void renderMesh(const Mesh &meshPtr, const glm::mat4 &model, glm::vec4 color = glm::vec4(0.8f, 0.5f, 0.3f, 1.0f)) {
@@ -162,11 +259,7 @@ class Application {
 		s.set(s.U.uView, view);
 		s.set(s.U.uProj, projection);
 
-		if (isArticulated) {
-			static std::unique_ptr<ArticulatedFigure> articulated = std::make_unique<ArticulatedFigure>(motion);
-			glm::mat4 *boneModels = new glm::mat4[5];
-			articulated->evaluateBones(time, orientType, interpType, boneModels);
-
+		if (isArticulated && articulated) {
 			// torso: draw original mesh at torso transform (assuming mesh is torso)
 			renderMesh(*boneMeshes[0].get(), boneModels[0]);
 
@@ -194,50 +287,46 @@ class Application {
 		// Render physics spheres
 		if (sphereMesh && shader) {
 			for (const auto &b : physics.bodies) {
+				if (b.shape != RigidBody::SPHERE) continue; // bone capsules are drawn by the figure
 				glm::mat4 model = glm::translate(glm::mat4(1.0f), b.position) * glm::mat4_cast(b.orientation) *
 				                  glm::scale(glm::mat4(1.0f), glm::vec3(b.radius));
 				renderMesh(*sphereMesh.get(), model);
 			}
 		}
 
-		if (flock && boidMesh && shader) {
-			for (const auto &b : flock->boids) {
-				// orient boid to face velocity direction if velocity significant
-				glm::vec3 dir = b.velocity;
-				glm::mat4 orient = glm::mat4(1.0f);
-				if (glm::dot(dir, dir) > 1e-6f) {
-					glm::vec3 forward = glm::normalize(dir);
-					// build a tiny rotation that maps +Z to forward
-					glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-					glm::vec3 right = glm::cross(up, forward);
-					if (glm::dot(right, right) < 1e-5f) {
-						// forward parallel to up; create fallback basis
-						right = glm::vec3(1.0f, 0.0f, 0.0f);
-					} else {
-						right = glm::normalize(right);
-					}
-					up = glm::normalize(glm::cross(forward, right));
-					glm::mat4 rot;
-					rot[0] = glm::vec4(right, 0.0f);
-					rot[1] = glm::vec4(up, 0.0f);
-					rot[2] = glm::vec4(forward, 0.0f);
-					rot[3] = glm::vec4(0, 0, 0, 1);
-					orient = rot;
-				}
-				glm::mat4 model = glm::translate(glm::mat4(1.0f), b.position) * orient * glm::scale(glm::mat4(1.0f), glm::vec3(b.radius));
-				renderMesh(*boidMesh.get(), model);
-			}
-		}
+		// boid orientation/scale is packed by Flock::update (writeInstances), nothing per boid happens here
+		if (flock && boidMesh && instanceShader && !flock->instances.empty()) renderBoids(view, projection);
 
 		if (particleEmitter && particleMesh && shader) {
 			Shader &s = *shader;
 			s.use();
+			if (particleEmitter->params.depthSort) particleEmitter->sortByDepth(view);
 			particleEmitter->renderAll([&](const glm::mat4 &model, const glm::vec4 &color, float size) {
 				glDepthMask(GL_FALSE);
 				glEnable(GL_BLEND);
 				renderMesh(*particleMesh.get(), model, color);
 			});
 		}
+
+		if (torches && particleMesh && shader) {
+			shader->use();
+			torches->sortByDepth(view);
+			torches->renderAll([&](const glm::mat4 &model, const glm::vec4 &color, float size) {
+				glDepthMask(GL_FALSE);
+				glEnable(GL_BLEND);
+				renderMesh(*particleMesh.get(), model, color);
+			});
+		}
+
+		if (showDebug) {
+			physics.debugDraw(debugDraw);
+			if (flock) flock->debugDraw(debugDraw, false, showCells);
+			if (particleEmitter) particleEmitter->debugDraw(debugDraw, false, showCells);
+			if (torches) torches->debugDraw(debugDraw, false, showCells);
+			glDisable(GL_DEPTH_TEST);
+			debugDraw.flush(view, projection);
+			glEnable(GL_DEPTH_TEST);
+		}
 	}
 
 	static void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
@@ -259,7 +348,9 @@ class Application {
 			app->boneMeshes.clear();
 			app->isArticulated = false;
 			app->flock = nullptr;
+			app->flowField = nullptr;
 			app->particleEmitter = nullptr;
+			app->torches = nullptr;
 			std::cout << "\n[CTRL+0] change preset to: null" << std::endl;
 		}
 		if (key == GLFW_KEY_1 && (mods & GLFW_MOD_CONTROL) && action == GLFW_PRESS) {
@@ -287,6 +378,13 @@ class Application {
 			app->createParticleEmitter(cfg.params);
 			std::cout << "\n[CTRL+5] change preset to: Fire_Long" << std::endl;
 		}
+		if (key == GLFW_KEY_B && (mods & GLFW_MOD_CONTROL) && action == GLFW_PRESS) {
+			// off -> overlay -> overlay with broadphase cells -> off
+			app->showCells = app->showDebug && !app->showCells;
+			app->showDebug = app->showCells || !app->showDebug;
+			app->physics.recordContacts = app->showDebug;
+			std::cout << "\n[CTRL+B] debug overlay: " << (app->showCells ? "on, with cells" : app->showDebug ? "on" : "off") << std::endl;
+		}
 		//
 		// scaler
 		if (key == GLFW_KEY_Q && (mods & GLFW_MOD_CONTROL) && action == GLFW_PRESS) {
@@ -489,6 +587,32 @@ class Application {
 			std::cout << "\n[SHIFT+C] change noiseTimeScale: " << cfg.params.noiseTimeScale << std::endl;
 			app->createParticleEmitter(cfg.params);
 		}
+		if (key == GLFW_KEY_P && (mods & GLFW_MOD_CONTROL) && action == GLFW_PRESS) {
+			static const char *names[] = {"NONE", "UNIFORM", "PERLIN", "CURL"};
+			cfg.params.noiseType = static_cast<EmitterParams::NoiseType>((cfg.params.noiseType + 1) % 4);
+			std::cout << "\n[CTRL+P] noiseType: " << names[cfg.params.noiseType] << std::endl;
+			app->createParticleEmitter(cfg.params);
+		}
+		if (key == GLFW_KEY_O && (mods & GLFW_MOD_CONTROL) && action == GLFW_PRESS) {
+			cfg.params.noiseOctaves++;
+			std::cout << "\n[CTRL+O] change noiseOctaves: " << cfg.params.noiseOctaves << std::endl;
+			app->createParticleEmitter(cfg.params);
+		}
+		if (key == GLFW_KEY_O && (mods & GLFW_MOD_SHIFT) && action == GLFW_PRESS) {
+			if (cfg.params.noiseOctaves > 1) cfg.params.noiseOctaves--;
+			std::cout << "\n[SHIFT+O] change noiseOctaves: " << cfg.params.noiseOctaves << std::endl;
+			app->createParticleEmitter(cfg.params);
+		}
+		if (key == GLFW_KEY_L && (mods & GLFW_MOD_CONTROL) && action == GLFW_PRESS) {
+			cfg.params.depthSort = !cfg.params.depthSort;
+			std::cout << "\n[CTRL+L] back-to-front depth sort: " << (cfg.params.depthSort ? "on" : "off") << std::endl;
+			app->createParticleEmitter(cfg.params);
+		}
+		if (key == GLFW_KEY_N && (mods & GLFW_MOD_CONTROL) && action == GLFW_PRESS) {
+			cfg.params.noiseGrid = !cfg.params.noiseGrid;
+			std::cout << "\n[CTRL+N] cached noise grid: " << (cfg.params.noiseGrid ? "on" : "off") << std::endl;
+			app->createParticleEmitter(cfg.params);
+		}
 		//
 		// mesh settings
 		if (key == GLFW_KEY_V && (mods & GLFW_MOD_CONTROL) && action == GLFW_PRESS) {
@@ -580,6 +704,7 @@ class Application {
 	}
 
 	~Application() {
+		if (boidInstanceVbo) glDeleteBuffers(1, &boidInstanceVbo);
 		if (window) glfwDestroyWindow(window);
 		glfwTerminate();
 	}
@@ -599,6 +724,7 @@ class Application {
 
 		// adding a few spheres with varying radius and initial velocities
 		physics.bodies.clear();
+		boneColliders.clear(); // recreated on next update
 		srand(seed);
 		for (int i = 0; i < N; ++i) {
 			RigidBody b;
@@ -626,6 +752,8 @@ class Application {
 
 	void createFlock(int N = 48) {
 		flock = std::make_unique<Flock>(N, seed);
+		flock->threadPool = &pool;
+		flock->writeInstances = true;
 		if (!boidMesh) boidMesh = GeometryFactory::createSphere(1.0f, 8, 6);
 		flock->neighborRadius = 0.9f;
 		flock->separationRadius = 0.28f;
@@ -635,10 +763,48 @@ class Application {
 		flock->wWander = 0.15f;
 		flock->wAvoid = 2.5f;
 		flock->worldRadius = 10.0f;
+		flock->lodCamera = glm::vec3(0.0f, 2.0f, 5.0f); // matches the view in render()
+		flock->updateInstances();
+	}
+
+	// bake obstacle avoidance and world confinement into a flow field the boids sample instead of testing every body
+	void enableFlockFlowField(float cellSize = 0.3f) {
+		if (!flock) createFlock();
+		float r = flock->worldRadius + 1.0f;
+		flowField = std::make_unique<FlowField>();
+		flowField->init(glm::vec3(-r), glm::vec3(r), cellSize);
+		flowField->boidRadius = flock->boidRadius;
+		flowField->worldRadius = flock->worldRadius;
+		flowField->bake(&physics);
+		flock->flowField = flowField.get();
+		flock->wFlow = flock->centerPull;
+	}
+
+	// recompute steering for 1/k of the boids per frame, nearest to the camera first (k <= 1 disables)
+	void setFlockLod(int k) {
+		if (!flock) createFlock();
+		flock->lodMode = k > 1 ? Flock::LodMode::CameraDistance : Flock::LodMode::Off;
+		flock->lodInterval = k;
 	}
 
 	void createParticleEmitter(const EmitterParams &params = EmitterParams()) {
 		particleEmitter = std::make_unique<ParticleEmitter>(params);
+		particleEmitter->threadPool = &pool;
+		if (!particleMesh) particleMesh = GeometryFactory::createSphere(1.0f, 10, 8);
+	}
+
+	// N small fires on a ring sharing a pool of budget particles; every tenth torch has priority and keeps its full
+	// maxParticles when the budget is short, the others split the rest
+	void createTorches(int N, size_t budget = 20000) {
+		torches = std::make_unique<ParticleSystem>(budget);
+		torches->threadPool = &pool;
+		EmitterParams p = EmitterConfigurator::preset(EmitterConfigurator::Fire).withEmitRate(300.0f).withMaxParticles(400).params;
+		for (int i = 0; i < N; i++) {
+			float a = 2.0f * std::numbers::pi_v<float> * float(i) / float(std::max(N, 1));
+			ParticleEmitter &e = torches->add(p, i % 10 == 0 ? 1 : 0);
+			e.setTransform(glm::translate(glm::mat4(1.0f), glm::vec3(4.0f * std::cos(a), -1.0f, 4.0f * std::sin(a))) *
+			               glm::scale(glm::mat4(1.0f), glm::vec3(0.25f)));
+		}
 		if (!particleMesh) particleMesh = GeometryFactory::createSphere(1.0f, 10, 8);
 	}
 
@@ -702,6 +868,7 @@ void parseKeyframe(const std::string &str, MotionController &motion) {
 void parseIO(int argc, char **argv, Application &app) {
 	std::vector<std::string> fnVec; //= {"teapot.obj"};
 	auto motion = std::make_shared<MotionController>();
+	bool articulated = false;
 	OrientationType orientType = OrientationType::Quaternion;
 	InterpType interpType = InterpType::CatmullRom;
 
@@ -731,7 +898,7 @@ void parseIO(int argc, char **argv, Application &app) {
 			fnVec.push_back(fn);
 			continue;
 		} else if (args == "-articulated") {
-			app.enableArticulated();
+			articulated = true; // needs meshes and motion, enabled after loading
 			continue;
 		} else if (args == "-seed" && i + 1 < argc) {
 			app.seed = static_cast<unsigned int>(std::stoi(argv[++i]));
@@ -744,6 +911,15 @@ void parseIO(int argc, char **argv, Application &app) {
 			int N = std::stoi(argv[++i]);
 			app.createFlock(N);
 			continue;
+		} else if (args == "-torches" && i + 1 < argc) {
+			app.createTorches(std::stoi(argv[++i]));
+			continue;
+		} else if (args == "-flocklod" && i + 1 < argc) {
+			app.setFlockLod(std::stoi(argv[++i]));
+			continue;
+		} else if (args == "-flockflow") {
+			app.enableFlockFlowField();
+			continue;
 		} else if (args == "-h" || args == "--help") {
 			std::cout << "Usage: " << argv[0] << " [options]\n"
 			          << "Options:\n"
@@ -757,14 +933,18 @@ void parseIO(int argc, char **argv, Application &app) {
 			          << "  -seed <number>           Seed for random number generator in physics scene (default: 12345)\n"
 			          << "  -physicscene <N>         Create physics scene with N spheres (default: 6)\n"
 			          << "  -flock <N>               Create flocks with N boids (default: 48)\n"
+			          << "  -flockflow               Flock samples a baked flow field for avoidance and confinement (after -flock)\n"
+			          << "  -flocklod <k>            Recompute flock steering for 1/k of the boids per frame, nearest first (after -flock)\n"
+			          << "  -torches <N>             N small fires sharing one particle pool of 20000, every tenth has priority\n"
 			          << "  -h, --help               Show this help message\n"
 			          << "\nParticle Emitter Keyboard Controls:\n"
-			          << "  CTRL+0                   Reset: disable articulated figure, flock, and particles\n"
+			          << "  CTRL+0                   Reset: disable articulated figure, flock, particles and torches\n"
 			          << "  CTRL+1                   Load particle preset: Fountain\n"
 			          << "  CTRL+2                   Load particle preset: Plasma\n"
 			          << "  CTRL+3                   Load particle preset: Smoke\n"
 			          << "  CTRL+4                   Load particle preset: Snow\n"
 			          << "  CTRL+5                   Load particle preset: Fire_Long\n"
+			          << "  CTRL+B                   Cycle debug overlay (contacts, velocities, particles), then with broadphase cells\n"
 			          << "\n"
 			          << "  CTRL+Q / SHIFT+Q         Increase / decrease scale factor (for adjustments)\n"
 			          << "  CTRL+W / SHIFT+W         Increase / decrease maxParticles\n"
@@ -789,9 +969,13 @@ void parseIO(int argc, char **argv, Application &app) {
 			          << "  CTRL+Z / SHIFT+Z         Increase / decrease noiseAmplitude\n"
 			          << "  CTRL+X / SHIFT+X         Increase / decrease noiseFrequency\n"
 			          << "  CTRL+C / SHIFT+C         Increase / decrease noiseTimeScale\n"
+			          << "  CTRL+P                   Cycle noiseType (NONE/UNIFORM/PERLIN/CURL)\n"
+			          << "  CTRL+O / SHIFT+O         Increase / decrease noiseOctaves (fBm)\n"
+			          << "  CTRL+N                   Toggle cached noise grid (noise sampled from a per-frame lattice)\n"
 			          << "\n"
 			          << "  Particle Mesh:\n"
 			          << "  CTRL+V / SHIFT+V         Cycle through particle mesh types (Sphere/Cube/Cylinder)\n"
+			          << "  CTRL+L                   Toggle back-to-front depth sort (for alpha blending)\n"
 			          << "\n"
 			          << "Notes:\n"
 			          << "  - All CTRL combinations increase values.\n"
@@ -812,6 +996,7 @@ void parseIO(int argc, char **argv, Application &app) {
 	app.loadModels(fnVec);
 	app.setController(motion);
 	app.setInterpolation(orientType, interpType);
+	if (articulated) app.enableArticulated();
 }
 
 int main(int argc, char **argv) {